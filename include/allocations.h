@@ -0,0 +1,55 @@
+#ifndef __ALLOCATIONS_H__
+#define __ALLOCATIONS_H__
+
+//The MPI program replaces the global operator new, so that it can count
+//how many heap allocations the ray tracing library makes while it
+//renders. Every thread is counted, including the render pool's.
+
+//This function turns the counting of heap allocations on or off.
+//
+//Inputs:
+//    enabled - true to count allocations from now on
+void countAllocations(bool enabled);
+
+//This function returns the number of heap allocations that were made
+//while counting was turned on.
+long long allocationCount();
+
+//The scene arena gives the objects that initialize() creates contiguous
+//storage. While a thread uses the arena, which is only while a scene is
+//being loaded, its allocations are cut one after the other from a single
+//reserved range of address space, so the objects of a scene end up next
+//to each other in the order they were built. The arena belongs to the
+//whole process, and the scenes of all render threads share it.
+//
+//Deleting an arena object only gives its memory back if it was the last
+//one handed out and the scene is still being loaded. Every other freed
+//temporary, and every buffer a vector has outgrown, stays unused until
+//the process exits. shutdown() still runs the destructors of the scene;
+//only the frees are skipped. The whole range goes back to the system in
+//one piece when the process exits; it cannot be unmapped any earlier,
+//since the ConfigData and whatever the library keeps in globals still
+//refer to it until main() has returned.
+
+//This function turns the scene arena on or off for the whole process and
+//reserves its address space. It has to be called before any scene is
+//loaded. The arena stays off if the address space cannot be reserved.
+//
+//Inputs:
+//    enabled - true to let useSceneArena() take effect
+void enableSceneArena(bool enabled);
+
+//This function makes the allocations of the calling thread come from
+//the scene arena, if it is enabled. Only one thread may use the arena
+//at a time.
+//
+//Inputs:
+//    enabled - true while a scene is being loaded
+void useSceneArena(bool enabled);
+
+//This function returns the number of bytes handed out by the scene
+//arena. That includes the objects that were freed again, and the
+//library's buffer of about 48 bytes per image pixel of every scene.
+long long sceneArenaBytes();
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __CACHE_MISSES_H__
+#define __CACHE_MISSES_H__
+
+//The cache misses made while shading are counted with the hardware
+//counters that Linux offers through perf_event_open(). Every thread
+//opens counters of its own the first time it shades with counting
+//turned on, and the render pool brackets every job with
+//startThreadCount() and stopThreadCount(), so that only the shading is
+//counted and not the communication or the image output.
+
+//This function turns the counting of cache misses on or off.
+//
+//Inputs:
+//    enabled - true to count cache misses from now on
+void countCacheMisses(bool enabled);
+
+//This function starts counting on the calling thread.
+void startThreadCount();
+
+//This function stops counting on the calling thread and adds what it
+//counted to the totals.
+void stopThreadCount();
+
+//This function tells whether the counters could be opened on every
+//thread that shaded. Virtual machines and containers often do not
+//expose the hardware counters.
+bool cacheMissesAvailable();
+
+//This function returns the number of last-level cache misses that were
+//counted.
+long long cacheMissCount();
+
+//This function returns the number of last-level cache references that
+//were counted.
+long long cacheReferenceCount();
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __COST_MODEL_H__
+#define __COST_MODEL_H__
+
+#include "RayTrace.h"
+#include "decomposition.h"
+
+//The cost model splits the image into one rectangle per process so that
+//every rectangle is expected to take about as long to render, instead
+//of giving every process the same number of pixels.
+//
+//The cost is estimated with a sparse pre-pass: one pixel is shaded at
+//the center of every spacing x spacing cell of the image and timed with
+//the cycle counter, and that time is taken as the cost of every pixel
+//in the cell. The processes share the pre-pass and combine their cells
+//with MPI_Allreduce, so every one of them ends up with the same cost
+//grid and computes the same rectangles.
+//
+//The rectangles come from recursive bisection: a region and the ranks
+//it is meant for are split in two across its longer side, at the point
+//where the estimated cost divides in the same ratio as the ranks.
+
+//This function estimates the cost of the image and splits it between
+//the processes. Every process has to call it.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    spacing - the distance between two sampled pixels, at least 1
+//    decomposition - receives one rectangle per rank; ranks can be left
+//        without one when there are more ranks than pixels
+void costPartition(ConfigData* data, int spacing, Decomposition* decomposition);
+
+#endif
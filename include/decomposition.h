@@ -0,0 +1,115 @@
+#ifndef __DECOMPOSITION_H__
+#define __DECOMPOSITION_H__
+
+#include <vector>
+#include "RayTrace.h"
+#include "options.h"
+
+//A decomposition describes which pixels every process renders with the
+//static partitioning schemes, as a list of rectangles per rank. The
+//master and the slaves build the same decomposition from the same
+//parameters, so they always agree on who renders what.
+//
+//A rank sends the pixels of its rectangles to the master in order, every
+//one of them row by row, packed behind each other. The order in which
+//they are rendered is given by rankWork().
+typedef struct
+{
+    int procs;
+
+    //TILE_INFO_SIZE integers for every rectangle, rank by rank:
+    //{ start column, start row, width, height }
+    std::vector<int> rects;
+
+    //The index of the first rectangle of every rank, followed by the
+    //total number of rectangles
+    std::vector<int> first;
+} Decomposition;
+
+//This function splits a length into nearly equal parts. The first
+//total % parts parts are one longer than the others.
+//
+//Inputs:
+//    total - the length to split
+//    parts - the number of parts
+//    part - the part to compute
+//    start - receives the start of the part
+//    count - receives the length of the part
+void evenSplit(int total, int parts, int part, int* start, int* count);
+
+//This function factors a number of processes into a grid whose cells
+//are as close to square as possible on an image of the given size.
+//
+//Inputs:
+//    procs - the number of processes
+//    width, height - the size of the image
+//    columns, rows - receive the shape of the grid; columns * rows
+//        is always procs
+void gridShape(int procs, int width, int height, int* columns, int* rows);
+
+//This function builds the decomposition of a static partitioning scheme:
+//    strips - one strip per rank across the image
+//    blocks - a near-square grid of blocks with gridShape(), or blocks of
+//        equal cost with costPartition() when costSpacing is set
+//    cycles - bands of cycleSize rows or columns dealt out round robin
+//With the cost model every process has to call it.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    costSpacing - the spacing of the cost model's samples for static
+//        blocks, or 0 for equal blocks
+//    decomposition - the Decomposition to fill in
+void staticDecomposition(ConfigData* data, int costSpacing, Decomposition* decomposition);
+
+//This function starts an empty decomposition. Rectangles are then added
+//rank by rank with addRect() and nextRank().
+//
+//Inputs:
+//    procs - the number of processes
+//    decomposition - the Decomposition to start
+void startDecomposition(int procs, Decomposition* decomposition);
+
+//This function adds a rectangle to the rank that is being filled in.
+//Empty rectangles are left out.
+void addRect(Decomposition* decomposition, int start_column, int start_row, int columns, int rows);
+
+//This function finishes the rank that is being filled in and moves on
+//to the next one.
+void nextRank(Decomposition* decomposition);
+
+//This function lists the rows of a rank's rectangles in the order in
+//which the rank renders and sends them.
+//
+//Inputs:
+//    decomposition - the Decomposition
+//    rank - the rank
+//    segments - receives TILE_INFO_SIZE integers for every row:
+//        { start column, row, width, offset of its first pixel among
+//        the rank's pixels }
+//
+//Outputs:
+//    The number of pixels that the rank renders
+int rowSegments(Decomposition* decomposition, int rank, std::vector<int>& segments);
+
+//Number of integers used to describe a piece of a rank's work:
+//{ start column, start row, width, height, offset of its first pixel
+//among the rank's pixels, pixels between the starts of two of its rows
+//among the rank's pixels }
+#define WORK_INFO_SIZE 6
+
+//This function cuts a rank's rectangles into the pieces that its
+//threads render. With ORDER_ROWS every row is a piece; with a curve
+//order the rectangles are cut into TRAVERSAL_TILE_SIZE tiles that are
+//listed along the curve.
+//
+//Inputs:
+//    decomposition - the Decomposition
+//    rank - the rank
+//    order - the traversal order
+//    work - receives WORK_INFO_SIZE integers for every piece
+//
+//Outputs:
+//    The number of pixels that the rank renders
+int rankWork(Decomposition* decomposition, int rank, TraversalOrder order, std::vector<int>& work);
+
+#endif
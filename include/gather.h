@@ -0,0 +1,97 @@
+#ifndef __GATHER_H__
+#define __GATHER_H__
+
+#include <mpi.h>
+#include "RayTrace.h"
+#include "decomposition.h"
+
+//The gather stage collects the rendered pixels from all of the slaves on
+//the master. Every slave's part of the image is described by an MPI
+//datatype, so its pixels are received straight into their final place
+//in the image without being copied around afterwards. The receives are
+//posted before the master starts on its own share of the image, so the
+//slaves' data can come in while the master is still rendering.
+//
+//With a compact wire format the pixels are received into a buffer per
+//slave instead, and decoded into their rows of the image as soon as the
+//slave's buffer has arrived.
+typedef struct
+{
+    int procs;
+    int width;
+
+    //The image that the pixels go into
+    float* pixels;
+
+    //The parts of the image that the slaves send
+    Decomposition* decomposition;
+
+    //The part of the image that every slave sends, when floats are sent
+    MPI_Datatype* types;
+
+    //The encoded pixels of every slave, or NULL when floats are sent
+    unsigned char** buffers;
+
+    //The computation time reported by every slave
+    double* times;
+
+    //The pixel receives for ranks 1..procs-1 followed by the receives
+    //for their computation times
+    MPI_Request* requests;
+} SlaveGather;
+
+//This function creates a datatype for the pixels that a process renders
+//with a static partitioning scheme. The pixels are expected in the order
+//given by rowSegments(), which is the order in which the slaves store
+//them.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    decomposition - the Decomposition of the image
+//    proc - the rank of the process
+//
+//Outputs:
+//    A committed datatype to be used with the start of the image
+MPI_Datatype decompositionType(ConfigData* data, Decomposition* decomposition, int proc);
+
+//This function posts the receives for the pixels and the computation
+//time of every slave.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    pixels - the image on the master
+//    decomposition - the Decomposition of the image; it has to outlive
+//        the gather
+//    gather - the SlaveGather to set up
+void startGather(ConfigData* data, float* pixels, Decomposition* decomposition, SlaveGather* gather);
+
+//This function waits until the pixels and computation times of all of
+//the slaves are in. All memory held by the gather is released before it
+//returns.
+//
+//Inputs:
+//    gather - the SlaveGather set up by startGather()
+//    rank_times - if not NULL, receives the computation time of every
+//        slave in rank_times[1..procs-1]
+//
+//Outputs:
+//    The largest computation time reported by a slave
+double finishGather(SlaveGather* gather, double* rank_times);
+
+//This function receives the statistics that every slave sends with
+//TAG_DATA when the dynamic schedulers are done: its computation and
+//communication time, followed by any others the scheduler keeps.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    values - the number of doubles every slave sends; at least 2
+//    stats - if not NULL, receives the values of every slave, those of
+//        rank proc starting at stats[values * proc]
+//    communicationTime - receives the largest communication time reported
+//        by a slave
+//
+//Outputs:
+//    The largest computation time reported by a slave
+double collectSlaveStats(ConfigData* data, int values, double* stats, double* communicationTime);
+
+#endif
@@ -2,27 +2,75 @@
 #define __MASTER_PROCESS_H__
 
 #include "RayTrace.h"
+#include "options.h"
+#include "pngstream.h"
+#include "outputimage.h"
 
 //This function is the main that only the master process
 //will run.
 //
 //Inputs:
 //    data - the ConfigData that holds the scene information.
+//    options - the RunOptions parsed from the command line.
 //
 //Outputs: None
-void masterMain( ConfigData *data );
+void masterMain( ConfigData *data, RunOptions *options );
 
 //This function will perform ray tracing when no MPI use was
 //given.
 //
 //Inputs:
 //    data - the ConfigData that holds the scene information.
+//    image - the image to fill in.
 //
 //Outputs: None
-void masterSequential(ConfigData *data, float* pixels);
-void masterMPI_Horizontal(ConfigData *data, float *pixels);
-void masterMPI_Vertical(ConfigData *data, float *pixels); 
-void masterMPI_Block(ConfigData *data, float *pixels);
-void masterMPI_CyclicVertical(ConfigData *data, float *pixels);
-void masterCyclesV(ConfigData *data, float *pixels);
+void masterSequential(ConfigData *data, OutputImage* image);
+
+//This function renders the master's share of the image with any of the
+//static partitioning schemes and collects the slaves' shares. It has to
+//be paired with slaveStatic on the slaves.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    image - the image to fill in. When it is kept on disk, the master
+//        renders its share a band at a time and the slaves send theirs in
+//        pieces that fit into the master's buffers.
+//    costSpacing - the spacing of the cost model's samples for static
+//        blocks, or 0 for equal blocks
+//
+//Outputs: None
+void masterStatic(ConfigData *data, OutputImage *image, int costSpacing);
+
+//This function renders the master's horizontal strip and collects the
+//others with MPI_Gatherv straight into the image, and the slaves'
+//computation times with MPI_Reduce. It has to be paired with
+//slaveMPIHorizontalCollective on the slaves.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    image - the image to fill in; it has to be held in memory.
+//
+//Outputs: None
+void masterMPI_HorizontalCollective(ConfigData *data, OutputImage *image);
+
+//This function hands out one tile at a time to the slaves that ask for
+//one and collects the rendered tiles into the image. It is paired with
+//slaveDynamic on the slaves.
+void masterDynamic(ConfigData *data, OutputImage *image);
+
+//This function hands out tiles like masterDynamic, but writes every band
+//of tile rows to the PNG file as soon as all of its tiles are in, so the
+//master only keeps the bands that are still being rendered. It is paired
+//with slaveDynamic on the slaves.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    stream - the open PngStream to write the image to.
+//
+//Outputs: None
+void masterStreaming(ConfigData *data, PngStream *stream);
+
+//This function hands out shrinking runs of tiles and points idle slaves
+//at busy ones to steal from. It is paired with slaveGuided on the slaves.
+void masterGuided(ConfigData *data, OutputImage *image);
 #endif
@@ -0,0 +1,92 @@
+#ifndef __RUN_OPTIONS_H__
+#define __RUN_OPTIONS_H__
+
+//Specify the schedulers that can be used with dynamic partitioning.
+typedef enum {
+    SCHED_FIXED = 0,
+    SCHED_GUIDED = 1
+} SchedType;
+
+//Specify how the static horizontal strips are gathered on the master.
+typedef enum {
+    GATHER_P2P = 0,
+    GATHER_COLLECTIVE = 1
+} GatherType;
+
+//Specify how pixels are encoded when they are sent to the master.
+typedef enum {
+    WIRE_FLOAT = 0,
+    WIRE_HALF = 1,
+    WIRE_BYTE = 2
+} WireFormat;
+
+//Specify the order in which pixels and tiles are shaded.
+typedef enum {
+    ORDER_ROWS = 0,
+    ORDER_MORTON = 1,
+    ORDER_HILBERT = 2
+} TraversalOrder;
+
+//Define a structure that holds the options that belong to the MPI
+//program rather than to the ray tracing library.
+typedef struct
+{
+    //Scheduler used when dynamic partitioning is selected
+    SchedType scheduler;
+
+    //Number of threads every process renders with
+    int threads;
+
+    //How the horizontal strips are collected on the master
+    GatherType gather;
+
+    //Whether the master writes the image while it is being rendered
+    bool stream;
+
+    //How pixels are encoded when they are sent to the master
+    WireFormat wire;
+
+    //Whether the heap allocations made while rendering are counted
+    bool allocations;
+
+    //Whether a load-balance profile is recorded
+    bool profile;
+
+    //Spacing of the pre-pass samples that static blocks are sized from,
+    //or 0 to split the image into equal blocks
+    int costSpacing;
+
+    //Order in which pixels and tiles are shaded
+    TraversalOrder order;
+
+    //Whether the cache misses made while shading are counted
+    bool cacheMisses;
+
+    //Whether rank 0 reads the scene files and broadcasts them
+    bool stage;
+
+    //Whether the scenes are kept in an arena
+    bool arena;
+
+    //Size in megabytes of the master's pixel buffers when the image is
+    //kept on disk, or 0 to keep the image in memory
+    int outOfCore;
+
+} RunOptions;
+
+//This function pulls the MPI program's own parameters out of the
+//command line and stores them in the RunOptions struct. The library's
+//initialize() rejects parameters that it does not know about, so this
+//has to be called first. Everything that is not recognized is left in
+//argv for initialize() to handle.
+//
+//Inputs:
+//    argc - The pointer to the number of input arguments
+//    argv - The pointer to the input arguments
+//    options - The pointer to the RunOptions struct to fill in
+//
+//Outputs:
+//    true if there was an error in the processing; otherwise, false
+bool parseRunOptions(int* argc, char** argv[], RunOptions* options);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __OUTPUT_IMAGE_H__
+#define __OUTPUT_IMAGE_H__
+
+#include <string>
+#include "RayTrace.h"
+
+//The image that the master collects the rendered pixels in. Normally it
+//is held in memory and saved with savePixels() at the end. For images
+//that do not fit into the master's memory it is kept out of core
+//instead: the pixels are written to a file next to the output as they
+//come in, and the PNG is encoded from that file a band of rows at a
+//time. This bounds only the master's image buffers; the buffer that the
+//library allocates with every scene, about 48 bytes per pixel, still
+//grows with the width times the height.
+typedef struct
+{
+    int width;
+    int height;
+
+    //The whole image, or NULL when it is kept on disk
+    float* pixels;
+
+    //The file that holds the image otherwise, as floats row by row. It
+    //is removed as soon as it has been created, so it disappears with
+    //the process.
+    int file;
+
+    //The most floats that a buffer on the master may hold, or 0 when the
+    //image was meant to be kept in memory. The pixels are collected in
+    //pieces of this size even if the file could not be created.
+    int bufferValues;
+
+    //Whether writing the file failed
+    bool failed;
+} OutputImage;
+
+//This function returns the number of floats in a buffer of the given
+//size. It is always a whole number of pixels.
+//
+//Inputs:
+//    megabytes - the size of the buffer
+int imageBufferValues(int megabytes);
+
+//This function sets up the image. If the file of an out-of-core image
+//cannot be created, the image is kept in memory instead.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    filename - the name of the PNG that will be written; the file of
+//        an out-of-core image is created next to it
+//    megabytes - the size of the master's buffers for an out-of-core
+//        image, or 0 to keep the image in memory
+//    image - the OutputImage to set up
+void openOutputImage(ConfigData* data, std::string filename, int megabytes, OutputImage* image);
+
+//This function copies a rectangle of pixels into the image.
+//
+//Inputs:
+//    image - the OutputImage
+//    pixels - the RGB values of the rectangle
+//    column, row - the position of the rectangle in the image
+//    width, height - the size of the rectangle
+//    stride - the number of pixels between the starts of two rows in
+//        pixels
+void putPixels(OutputImage* image, float* pixels, int column, int row, int width, int height, int stride);
+
+//This function writes the image as a PNG.
+//
+//Inputs:
+//    image - the OutputImage
+//    filename - the name of the PNG
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs:
+//    true if the image could not be saved; otherwise, false
+bool saveOutputImage(OutputImage* image, std::string filename, ConfigData* data);
+
+//This function releases the memory or the file of the image.
+void closeOutputImage(OutputImage* image);
+
+#endif
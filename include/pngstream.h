@@ -0,0 +1,60 @@
+#ifndef __PNG_STREAM_H__
+#define __PNG_STREAM_H__
+
+#include <cstdio>
+#include <string>
+#include <png.h>
+#include "RayTrace.h"
+
+//A PNG file that is written a few rows at a time, top to bottom, so the
+//image can be encoded while the rest of it is still being rendered.
+//The pixels are converted the same way savePixels() converts them.
+typedef struct
+{
+    FILE* file;
+    png_structp png;
+    png_infop info;
+
+    int width;
+    int height;
+
+    //The next row of the image that has to be written
+    int next_row;
+
+    //Scratch space for one row of 8-bit RGB values
+    png_bytep row;
+} PngStream;
+
+//This function creates the file and writes the PNG header.
+//
+//Inputs:
+//    filename - the name of the file to write
+//    data - the ConfigData that holds the scene information.
+//    stream - the PngStream to set up
+//
+//Outputs:
+//    true if the file could not be created; otherwise, false
+bool openPngStream(std::string filename, ConfigData* data, PngStream* stream);
+
+//This function encodes the next rows of the image.
+//
+//Inputs:
+//    stream - the PngStream to write to
+//    pixels - the RGB values of the rows, row by row
+//    rows - the number of rows in pixels
+//
+//Outputs:
+//    true if the rows could not be written; otherwise, false
+bool writePngRows(PngStream* stream, float* pixels, int rows);
+
+//This function finishes the file and frees the PngStream. All of the
+//rows should have been written by then.
+//
+//Inputs:
+//    stream - the PngStream to close
+//
+//Outputs:
+//    true if the file could not be finished; otherwise, false
+bool closePngStream(PngStream* stream);
+
+#endif
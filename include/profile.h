@@ -0,0 +1,73 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <string>
+#include "RayTrace.h"
+
+//The profiler records where the rendering time goes, so partitioning
+//schemes can be compared by more than their slowest process. While it
+//is on, every process measures:
+//    - the cost of the pixels it shades, in cycle counter ticks, added up
+//      per 16x16 cell of the image
+//    - busy time, spent inside parallelFor() shading pixels
+//    - communication time, spent inside blocking MPI calls
+//    - idle time, everything else between the start and the stop
+//Busy and communication time are also kept as a timeline of intervals,
+//so it can be seen when a process waited and not only how long. The
+//master collects all of it and writes a cost heatmap next to the image
+//along with a per-rank summary as CSV and JSON and the timelines as CSV.
+//Communication time is counted by the MPI wrappers in profilempi.cpp,
+//which are only linked with PROFILE_MPI=yes; without them it is counted
+//as idle.
+
+//This function returns whether the profiler is recording.
+bool profiling();
+
+//This function starts recording on this process. Every process has to
+//call it, with the same value of enabled.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    enabled - true to record a profile; otherwise nothing is done
+void startProfile(ConfigData* data, bool enabled);
+
+//This function reads the cycle counter that pixel costs are measured in.
+unsigned long long readCycleCounter();
+
+//This function records how much it cost to shade a pixel. It can be
+//called from any render thread.
+//
+//Inputs:
+//    row, column - the pixel
+//    cycles - the number of cycle counter ticks it took
+void recordPixelCost(int row, int column, unsigned long long cycles);
+
+//This function adds time spent shading on this process.
+//
+//Inputs:
+//    seconds - the wall time that was spent
+void addBusyTime(double seconds);
+
+//This function adds time spent in a blocking MPI call on this process.
+//
+//Inputs:
+//    seconds - the wall time that was spent
+void addCommunicationTime(double seconds);
+
+//This function stops recording and collects the pixel costs and the
+//per-rank times on the master. Every process has to call it.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+void stopProfile(ConfigData* data);
+
+//This function writes the collected profile on the master: the heatmap
+//to <image>_cost.png, the summary to <image>_profile.csv and
+//<image>_profile.json, and the timelines to <image>_timeline.csv.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    file - the name the image was saved under
+void writeProfile(ConfigData* data, std::string file);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+//Message tags that are shared between the master and the slaves.
+//The static partitioning schemes only ever use TAG_DATA; the
+//dynamic scheduler needs the rest to tell requests, work and
+//results apart when receiving from MPI_ANY_SOURCE.
+//
+//TAG_REQUEST - slave -> master, the tile just finished (empty on the
+//              first request); its pixels follow with TAG_RESULT
+//TAG_TILE - master -> slave, the next tile to render
+//TAG_TERMINATE - master -> slave, no tiles are left
+//
+//The guided scheduler hands out runs of consecutive tiles instead and
+//adds work stealing between the slaves:
+//TAG_REQUEST - slave -> master, the run just finished; its pixels follow
+//              with TAG_RESULT
+//TAG_TILE - master -> slave, the next run of tiles to render
+//TAG_VICTIM - master -> slave, nothing is left on the master; try to
+//             steal from the given slave instead
+//TAG_STEAL_REQUEST - slave -> slave, ask for part of the victim's run
+//TAG_STEAL_REPLY - slave -> slave, the tiles given away (may be none)
+typedef enum {
+    TAG_DATA = 0,
+    TAG_REQUEST = 1,
+    TAG_TILE = 2,
+    TAG_RESULT = 3,
+    TAG_TERMINATE = 4,
+    TAG_VICTIM = 5,
+    TAG_STEAL_REQUEST = 6,
+    TAG_STEAL_REPLY = 7
+} MessageTag;
+
+//Number of integers used to describe a tile on the wire:
+//{ start column, start row, width, height }
+#define TILE_INFO_SIZE 4
+
+//Number of integers used to describe a run of tiles on the wire:
+//{ first tile, tile count, victim }
+//The victim is only used in requests; it names the slave that a failed
+//steal was sent to, or is -1.
+#define RUN_INFO_SIZE 3
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef __REGION_BUFFER_H__
+#define __REGION_BUFFER_H__
+
+#include <vector>
+#include "RayTrace.h"
+#include "decomposition.h"
+#include "outputimage.h"
+
+//A region buffer holds the pixels that one rank renders with a static
+//partitioning scheme, and nothing else: its rectangles, each one row by
+//row, packed behind each other. That is the layout in which the pixels
+//are sent to the master, so a slave's memory only grows with its share
+//of the image. The master renders its own share straight into the image
+//with renderRegionInPlace() instead, unless the image is kept out of
+//core, where renderRegionBands() renders it a batch at a time and copies
+//it in with placeRegion().
+typedef struct
+{
+    //The rectangles of the rank
+    Decomposition* decomposition;
+    int rank;
+
+    //The number of floats in pixels
+    int values;
+    float* pixels;
+
+    //The pieces that the threads render, see rankWork()
+    std::vector<int> work;
+} RegionBuffer;
+
+//This function allocates the buffer for a rank's share of the image.
+//
+//Inputs:
+//    decomposition - the Decomposition of the image; it has to outlive
+//        the buffer
+//    rank - the rank whose share the buffer holds
+//    buffer - the RegionBuffer to set up
+void openRegionBuffer(Decomposition* decomposition, int rank, RegionBuffer* buffer);
+
+//This function renders the rank's share of the image into the buffer,
+//in the order set with setTraversalOrder().
+//
+//Inputs:
+//    buffer - the RegionBuffer
+//    data - the ConfigData that holds the scene information.
+void renderRegion(RegionBuffer* buffer, ConfigData* data);
+
+//This function copies the pixels of a buffer to their place in the
+//image.
+//
+//Inputs:
+//    buffer - the RegionBuffer
+//    image - the OutputImage
+void placeRegion(RegionBuffer* buffer, OutputImage* image);
+
+//This function renders a rank's share of the image straight into its
+//place in an image that is held in memory, without a region buffer. The
+//master uses it for its own share.
+//
+//Inputs:
+//    decomposition - the Decomposition of the image
+//    rank - the rank whose share is rendered
+//    data - the ConfigData that holds the scene information.
+//    pixels - the whole image
+void renderRegionInPlace(Decomposition* decomposition, int rank, ConfigData* data, float* pixels);
+
+//This function renders a rank's share of the image straight into an
+//out-of-core image. The share is rendered in batches of rectangles, and
+//of bands of rows of larger ones, that fit into one of the master's
+//buffers.
+//
+//Inputs:
+//    decomposition - the Decomposition of the image
+//    rank - the rank whose share is rendered
+//    data - the ConfigData that holds the scene information.
+//    image - the OutputImage
+void renderRegionBands(Decomposition* decomposition, int rank, ConfigData* data, OutputImage* image);
+
+//This function sends the pixels of a buffer to the master with TAG_DATA.
+//
+//Inputs:
+//    buffer - the RegionBuffer
+//    pieceValues - the most floats in a message, or 0 to send all of
+//        the pixels in one, even if there are none; a multiple of 3
+void sendRegion(RegionBuffer* buffer, int pieceValues);
+
+//This function receives the pixels that a rank sent with sendRegion()
+//in pieces of image->bufferValues floats, and puts them into the image.
+//
+//Inputs:
+//    decomposition - the Decomposition of the image
+//    rank - the rank that sent the pixels
+//    image - the OutputImage
+//    scratch - room for image->bufferValues floats
+void receiveRegion(Decomposition* decomposition, int rank, OutputImage* image, float* scratch);
+
+//This function releases the pixels of a buffer.
+void closeRegionBuffer(RegionBuffer* buffer);
+
+#endif
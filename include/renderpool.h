@@ -0,0 +1,42 @@
+#ifndef __RENDER_POOL_H__
+#define __RENDER_POOL_H__
+
+#include <functional>
+#include "RayTrace.h"
+
+//The render pool lets one MPI process shade its part of the image with
+//several threads. The library keeps per-ray state inside the Camera and
+//World objects, so shadePixel() cannot be called concurrently on the
+//same scene. Every extra thread therefore gets a scene of its own that
+//is loaded with the same command line; the calling thread keeps using
+//the ConfigData that was passed in.
+
+//This function starts the worker threads. It has to be called after
+//initialize() succeeded on the given ConfigData.
+//
+//Inputs:
+//    threads - the total number of threads to render with, including
+//        the calling thread; 1 renders on the calling thread only
+//    argc - the number of arguments that initialize() was given
+//    argv - the arguments that initialize() was given
+//    data - the ConfigData of the calling thread
+//
+//Outputs:
+//    true if there was an error in the processing; otherwise, false
+bool startRenderThreads(int threads, int argc, char* argv[], ConfigData* data);
+
+//This function runs body(index, scene) for every index in [0, count)
+//and returns once all of them are done. The indices are handed out to
+//the threads one at a time, and scene is the ConfigData that the thread
+//running the body has to pass to shadePixel().
+//
+//Inputs:
+//    count - the number of indices
+//    data - the ConfigData of the calling thread
+//    body - the work to do for a single index
+void parallelFor(int count, ConfigData* data, const std::function<void(int, ConfigData*)>& body);
+
+//This function stops the worker threads and cleans up their scenes.
+void stopRenderThreads();
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __SCENE_STAGE_H__
+#define __SCENE_STAGE_H__
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+//Scene staging keeps every process from reading the scene from shared
+//storage. Rank 0 reads the configuration file and the model and material
+//files it refers to, and broadcasts them. One process on every node
+//writes them into a private directory on node-local storage, with the
+//same relative paths, and the other ranks load the scene from there.
+//The ray tracing library only loads scenes from files, so the parsing
+//itself still happens on every rank.
+typedef struct
+{
+    //Whether this process moved into the staged copy
+    bool active;
+
+    //The working directory to return to
+    std::string home;
+
+    //The staged copy on this node, or empty
+    std::string directory;
+
+    //The staged files and the directories made for them, in the order
+    //they were created
+    std::vector<std::string> paths;
+
+    //The processes on the same node
+    MPI_Comm node;
+} SceneStage;
+
+//This function stages the scene given with -c. Every process has to
+//call it before initialize(). On success, every rank but 0 has its
+//working directory changed to the staged copy. Files that are not
+//inside the working directory are not staged, and are read as usual.
+//
+//Inputs:
+//    argc - the number of arguments that initialize() will be given
+//    argv - the arguments that initialize() will be given
+//    stage - the SceneStage to fill in
+void stageScene(int argc, char* argv[], SceneStage* stage);
+
+//This function adds up the size of the scene given with -c: the
+//configuration file and the model and material files that it refers to,
+//as far as they can be read. It is used to report how fast the scene
+//loads.
+//
+//Inputs:
+//    argc - the number of arguments that initialize() was given
+//    argv - the arguments that initialize() was given
+//
+//Outputs:
+//    The size of the files in bytes
+long long sceneSize(int argc, char* argv[]);
+
+//This function returns to the original working directory once the
+//scene is loaded and removes the staged copy. Every process has to
+//call it.
+//
+//Inputs:
+//    stage - the SceneStage filled in by stageScene()
+void finishStaging(SceneStage* stage);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef __SHADE_TILE_H__
+#define __SHADE_TILE_H__
+
+#include "RayTrace.h"
+
+//This function performs ray tracing on a rectangle of pixels, so the
+//partitioning code can hand over whole rows, columns or blocks instead
+//of shading pixel by pixel. The rectangle is checked against the image
+//once, instead of once per pixel. The colors are the same as the ones
+//shadePixel() gives for the same pixels. The pixels are visited in the
+//order set with setTraversalOrder().
+//
+//Inputs:
+//    out - receives the colors; pixel (row0 + r, col0 + c) is written to
+//        out[3 * (r * stride + c)] through out[3 * (r * stride + c) + 2]
+//    row0, col0 - the top left corner of the rectangle
+//    w, h - the width and height of the rectangle
+//    stride - the number of pixels between the starts of two rows of the
+//        rectangle in out; at least w, or 1 for a single column
+//    data - the pointer to the ConfigData struct that contains the
+//        scene information.
+void shadeTile(float* out, int row0, int col0, int w, int h, int stride, ConfigData* data);
+
+#endif
@@ -2,10 +2,14 @@
 #define __SLAVE_PROCESS_H__
 
 #include "RayTrace.h"
+#include "options.h"
 
-void slaveMain( ConfigData *data );
-void slaveMPIHorizontal(ConfigData *data);
-void slaveMPIVertical(ConfigData *data);
-void slaveMPIBlock(ConfigData *data);
-void slaveMPICylicVertical(ConfigData *data);
+void slaveMain( ConfigData *data, RunOptions *options );
+void slaveStatic(ConfigData *data, int costSpacing, int pieceValues);
+void slaveMPIHorizontalCollective(ConfigData *data);
+//This function renders the tiles that the master hands out one at a time.
+void slaveDynamic(ConfigData *data);
+//This function renders runs of tiles from the master or stolen from other
+//slaves, and gives away half of its own run when asked.
+void slaveGuided(ConfigData *data);
 #endif
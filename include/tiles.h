@@ -0,0 +1,36 @@
+#ifndef __TILES_H__
+#define __TILES_H__
+
+#include "RayTrace.h"
+#include "options.h"
+
+//The dynamic schedulers cut the image into dynamicBlockWidth x
+//dynamicBlockHeight tiles that are numbered row by row, starting at the
+//top left corner, unless orderTiles() picked another order. Tiles on the
+//right and bottom edges may be smaller.
+
+//This function returns the number of tiles that cover the image.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+int tileCount(ConfigData* data);
+
+//This function numbers the tiles along a traversal order instead, so
+//that tiles with consecutive numbers are close to each other. The master
+//and the slaves have to use the same order.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    order - the traversal order
+void orderTiles(ConfigData* data, TraversalOrder order);
+
+//This function computes the position and size of a tile.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    index - the number of the tile, 0 <= index < tileCount(data)
+//    tile - an array of TILE_INFO_SIZE integers that receives
+//        { start column, start row, width, height }
+void tileBounds(ConfigData* data, int index, int* tile);
+
+#endif
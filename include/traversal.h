@@ -0,0 +1,39 @@
+#ifndef __TRAVERSAL_H__
+#define __TRAVERSAL_H__
+
+#include <vector>
+#include "options.h"
+
+//The traversal order decides in which order the pixels of a tile, and
+//the tiles of a rank's share of the image, are shaded. Walking them
+//along a space-filling curve keeps consecutive rays close together, so
+//they tend to hit the same parts of the scene while those are still in
+//the cache. The order never changes which pixels a rank renders or
+//where they end up, only when they are shaded.
+
+//Width and height of the tiles that the static schemes cut a rank's
+//rectangles into when a curve order is used.
+#define TRAVERSAL_TILE_SIZE 16
+
+//This function sets the order used by shadeTile() and the static
+//schemes. It has to be called before rendering starts.
+//
+//Inputs:
+//    order - the traversal order
+void setTraversalOrder(TraversalOrder order);
+
+//This function returns the order set by setTraversalOrder().
+TraversalOrder traversalOrder();
+
+//This function lists the cells of a grid in the given order. Grids that
+//are not square are walked as a row (or column) of squares, each of
+//them along the curve.
+//
+//Inputs:
+//    columns, rows - the size of the grid
+//    order - the traversal order
+//    cells - receives the index row * columns + column of every cell,
+//        in the order in which they are visited
+void curveOrder(int columns, int rows, TraversalOrder order, std::vector<int>& cells);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef __WIRE_H__
+#define __WIRE_H__
+
+#include <mpi.h>
+#include "options.h"
+
+//The wire format decides how pixels are sent from the slaves to the
+//master. Floats are sent as they are; the compact formats convert them
+//before sending and back to floats on the master:
+//    WIRE_HALF - IEEE 754 half floats, 6 bytes per pixel
+//    WIRE_BYTE - the 8-bit values that savePixels() writes, 3 bytes per
+//        pixel; the saved image is the same as with floats
+//The master also counts the pixel bytes it receives from every rank so
+//that the formats can be compared.
+
+//This function selects the wire format for this process and resets the
+//byte counts. Every process has to select the same format.
+//
+//Inputs:
+//    format - the wire format to use
+//    procs - the number of processes
+void setWireFormat(WireFormat format, int procs);
+
+//This function returns the wire format that was selected.
+WireFormat wireFormat();
+
+//This function returns the number of bytes that values floats take up
+//in the selected wire format.
+int wireBytes(int values);
+
+//This function converts a color channel to 8 bits the same way that
+//savePixels() does: values above 1 are clamped and everything else is
+//truncated.
+unsigned char quantizeChannel(float value);
+
+//This function converts floats to the selected wire format.
+//
+//Inputs:
+//    pixels - the floats to convert
+//    values - the number of floats
+//    buffer - receives wireBytes(values) bytes
+void encodePixels(float* pixels, int values, unsigned char* buffer);
+
+//This function converts pixels in the selected wire format to floats.
+//
+//Inputs:
+//    buffer - the wireBytes(values) bytes to convert
+//    values - the number of floats
+//    pixels - receives the floats
+void decodePixels(unsigned char* buffer, int values, float* pixels);
+
+//This function sends floats in the selected wire format.
+//
+//Inputs:
+//    pixels - the floats to send
+//    values - the number of floats
+//    dest - the rank to send to
+//    tag - the message tag
+void sendPixels(float* pixels, int values, int dest, int tag);
+
+//This function receives floats that were sent with sendPixels() and
+//counts their bytes.
+//
+//Inputs:
+//    pixels - receives the floats
+//    values - the number of floats
+//    source - the rank to receive from
+//    tag - the message tag
+//    status - receives the status of the receive
+void recvPixels(float* pixels, int values, int source, int tag, MPI_Status* status);
+
+//This function adds to the number of pixel bytes received from a rank,
+//for transfers that do not go through recvPixels().
+//
+//Inputs:
+//    rank - the rank the bytes came from
+//    bytes - the number of bytes
+void countWireBytes(int rank, long long bytes);
+
+//This function prints the number of pixel bytes that were received from
+//every rank. Nothing is printed if no pixels were received.
+void printWireBytes();
+
+#endif
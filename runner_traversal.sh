@@ -0,0 +1,44 @@
+#!/bin/bash
+#
+
+# This script benchmarks the traversal orders on the complex scene.
+# Every partitioning scheme is rendered with rows, Morton and Hilbert
+# order, and the execution time and the cache misses counted while
+# shading are collected into one table at the end.
+#
+# The cache misses come from the hardware performance counters, so
+# the nodes have to allow perf_event_open() (perf_event_paranoid of 2
+# or lower); otherwise they are reported as not available.
+
+# Name of the job - You MUST use a unique name for the job
+#SBATCH -J rt_traversal
+
+# Standard out and Standard Error output files
+#SBATCH -o rt_traversal%t.out
+#SBATCH -e rt_traversal%t.err
+
+#SBATCH -p tier3 -n 4
+#SBATCH --mem-per-cpu=2000M
+
+module load openmpi
+
+SIZE=${SIZE:-2000}
+SCHEMES=(
+    "-p static_blocks"
+    "-p static_cycles_vertical -cs 1"
+    "-p dynamic -bw 32 -bh 32"
+)
+
+printf "%-34s %-8s %12s %s\n" "Scheme" "Order" "Time (s)" "Cache Misses"
+for scheme in "${SCHEMES[@]}"
+do
+    for order in rows morton hilbert
+    do
+        output=$(srun -n $SLURM_NPROCS raytrace_mpi -h $SIZE -w $SIZE -c configs/box.xml $scheme -order $order -misses)
+
+        time=$(echo "$output" | sed -n 's/^Execution Time: \([^ ]*\).*/\1/p')
+        misses=$(echo "$output" | sed -n 's/^Cache Misses: //p')
+
+        printf "%-34s %-8s %12s %s\n" "$scheme" "$order" "$time" "$misses"
+    done
+done
@@ -0,0 +1,189 @@
+//This file contains the replacement of the global operator new and
+//delete that lets the MPI program count heap allocations and keep the
+//scene in an arena.
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/mman.h>
+#include "allocations.h"
+
+static std::atomic<bool> counting(false);
+static std::atomic<long long> allocations(0);
+
+//The scene arena is a single range of address space that is reserved
+//up front and committed ARENA_COMMIT_SIZE bytes at a time as it fills,
+//so whether an object belongs to it is one comparison. The pages are
+//only backed by memory once they are used.
+#define ARENA_RESERVATION ((size_t)64 << 30)
+#define ARENA_COMMIT_SIZE ((size_t)64 << 20)
+
+//Alignment of every object in the arena, the same as malloc()'s.
+#define ARENA_ALIGNMENT 16
+
+static bool arenaEnabled = false;
+static thread_local bool arenaActive = false;
+
+//The reserved range, the bytes committed and handed out, and where the
+//last object starts. The range stays known after it has been released,
+//so that deleting an object from it is still recognized.
+static char* arenaStart = NULL;
+static char* arenaEnd = NULL;
+static size_t arenaCommitted = 0;
+static size_t arenaUsed = 0;
+static size_t arenaLast = 0;
+static bool arenaReleased = false;
+
+//This function cuts an object from the arena, or returns NULL when the
+//arena cannot grow.
+static void* arenaAllocate(std::size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    if (size == 0)
+    {
+        size = ARENA_ALIGNMENT;
+    }
+
+    if (arenaStart == NULL || arenaReleased || size > ARENA_RESERVATION - arenaUsed)
+    {
+        return NULL;
+    }
+
+    if (arenaUsed + size > arenaCommitted)
+    {
+        size_t commit = (arenaUsed + size - arenaCommitted + ARENA_COMMIT_SIZE - 1) / ARENA_COMMIT_SIZE * ARENA_COMMIT_SIZE;
+        commit = std::min(commit, ARENA_RESERVATION - arenaCommitted);
+        if (mprotect(arenaStart + arenaCommitted, commit, PROT_READ | PROT_WRITE) != 0)
+        {
+            return NULL;
+        }
+        arenaCommitted += commit;
+    }
+
+    void* memory = arenaStart + arenaUsed;
+    arenaLast = arenaUsed;
+    arenaUsed += size;
+
+    return memory;
+}
+
+//This function tells whether an object was cut from the arena.
+static bool arenaOwns(void* memory)
+{
+    return (char*)memory >= arenaStart && (char*)memory < arenaEnd;
+}
+
+//This function gives the last object of the arena back, so temporaries
+//that are freed right away do not use up the arena.
+static void arenaFree(void* memory)
+{
+    if (arenaActive && (char*)memory == arenaStart + arenaLast && arenaLast < arenaUsed)
+    {
+        arenaUsed = arenaLast;
+    }
+}
+
+//This function gives the whole arena back to the system. It runs when
+//the process exits, after main() has returned and its ConfigData has
+//been destroyed, since that and the library still refer to the scene
+//until then.
+static void releaseSceneArena()
+{
+    munmap(arenaStart, ARENA_RESERVATION);
+    arenaReleased = true;
+}
+
+void enableSceneArena(bool enabled)
+{
+    //Only the address space is reserved here; it is committed as the
+    //arena grows.
+    if (enabled && arenaStart == NULL)
+    {
+        void* memory = mmap(NULL, ARENA_RESERVATION, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            arenaStart = (char*)memory;
+            arenaEnd = arenaStart + ARENA_RESERVATION;
+            atexit(releaseSceneArena);
+        }
+    }
+
+    arenaEnabled = enabled && arenaStart != NULL && !arenaReleased;
+}
+
+void useSceneArena(bool enabled)
+{
+    arenaActive = enabled && arenaEnabled;
+}
+
+long long sceneArenaBytes()
+{
+    return arenaUsed;
+}
+
+void countAllocations(bool enabled)
+{
+    counting = enabled;
+}
+
+long long allocationCount()
+{
+    return allocations;
+}
+
+void* operator new(std::size_t size)
+{
+    if (counting.load(std::memory_order_relaxed))
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (arenaActive)
+    {
+        void* memory = arenaAllocate(size);
+        if (memory != NULL)
+        {
+            return memory;
+        }
+    }
+
+    //Zero-sized allocations still have to return a unique pointer.
+    void* memory = malloc(size == 0 ? 1 : size);
+    if (memory == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    if (arenaOwns(memory))
+    {
+        arenaFree(memory);
+        return;
+    }
+
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    operator delete(memory);
+}
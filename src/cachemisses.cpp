@@ -0,0 +1,108 @@
+//This file contains the counting of cache misses with the hardware
+//performance counters.
+
+#include <atomic>
+#include <cstring>
+#include "cachemisses.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static std::atomic<bool> counting(false);
+static std::atomic<bool> available(true);
+static std::atomic<long long> misses(0);
+static std::atomic<long long> references(0);
+
+//The counters of the calling thread: misses, then references. -2 means
+//they have not been opened yet, -1 that they could not be.
+thread_local static int counters[2] = { -2, -2 };
+thread_local static long long startValues[2] = { 0, 0 };
+
+#ifdef __linux__
+static int openCounter(unsigned long long event)
+{
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = event;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    //Count the calling thread on whatever CPU it runs on.
+    return syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+static long long readCounter(int counter)
+{
+    long long value = 0;
+    if (read(counter, &value, sizeof(value)) != sizeof(value))
+    {
+        return 0;
+    }
+    return value;
+}
+#endif
+
+void countCacheMisses(bool enabled)
+{
+    counting = enabled;
+}
+
+void startThreadCount()
+{
+    if (!counting.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+#ifdef __linux__
+    if (counters[0] == -2)
+    {
+        counters[0] = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+        counters[1] = openCounter(PERF_COUNT_HW_CACHE_REFERENCES);
+    }
+
+    if (counters[0] < 0 || counters[1] < 0)
+    {
+        available = false;
+        return;
+    }
+
+    startValues[0] = readCounter(counters[0]);
+    startValues[1] = readCounter(counters[1]);
+#else
+    available = false;
+#endif
+}
+
+void stopThreadCount()
+{
+    if (!counting.load(std::memory_order_relaxed) || counters[0] < 0 || counters[1] < 0)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    misses += readCounter(counters[0]) - startValues[0];
+    references += readCounter(counters[1]) - startValues[1];
+#endif
+}
+
+bool cacheMissesAvailable()
+{
+    return available;
+}
+
+long long cacheMissCount()
+{
+    return misses;
+}
+
+long long cacheReferenceCount()
+{
+    return references;
+}
@@ -0,0 +1,189 @@
+//This file contains the cost-model partitioner: the sparse pre-pass
+//that estimates what the image costs to render, and the recursive
+//bisection that splits it into regions of equal cost.
+
+#include <vector>
+#include <algorithm>
+#include <mpi.h>
+#include "costmodel.h"
+#include "protocol.h"
+#include "renderpool.h"
+#include "profile.h"
+
+//Define a structure that holds the estimated cost of every cell.
+typedef struct
+{
+    int spacing;
+    int columns;
+    int rows;
+    float* cells;
+} CostGrid;
+
+//This function computes the estimated cost of every column, or every
+//row, of a region.
+//
+//Inputs:
+//    grid - the estimated costs
+//    region - the region { start column, start row, width, height }
+//    across - true for the cost of every column, false for every row
+//    lines - receives the costs, one per column or row of the region
+static void lineCosts(CostGrid* grid, int* region, bool across, std::vector<double>& lines)
+{
+    int start = across ? region[0] : region[1];
+    int count = across ? region[2] : region[3];
+    int other_start = across ? region[1] : region[0];
+    int other_count = across ? region[3] : region[2];
+
+    lines.assign(count, 0.0);
+
+    for (int line = 0; line < count; line++)
+    {
+        int cell = (start + line) / grid->spacing;
+
+        //Add up the cells that the line passes through, weighted by how
+        //many of their pixels are in the region.
+        int first_cell = other_start / grid->spacing;
+        int last_cell = (other_start + other_count - 1) / grid->spacing;
+        for (int other = first_cell; other <= last_cell; other++)
+        {
+            int overlap = std::min(other_start + other_count, (other + 1) * grid->spacing)
+                        - std::max(other_start, other * grid->spacing);
+
+            float cost = across ? grid->cells[other * grid->columns + cell]
+                                : grid->cells[cell * grid->columns + other];
+            lines[line] += (double)cost * overlap;
+        }
+    }
+}
+
+//This function splits a region between a range of ranks.
+//
+//Inputs:
+//    grid - the estimated costs
+//    region - the region { start column, start row, width, height }
+//    first_rank - the first rank that the region is meant for
+//    ranks - the number of ranks that the region is meant for
+//    regions - receives the rectangle of every one of those ranks
+static void splitRegion(CostGrid* grid, int* region, int first_rank, int ranks, int* regions)
+{
+    if (ranks == 1 || region[2] == 0 || region[3] == 0)
+    {
+        //An empty region leaves the remaining ranks with nothing to do.
+        for (int rank = first_rank; rank < first_rank + ranks; rank++)
+        {
+            for (int i = 0; i < TILE_INFO_SIZE; i++)
+            {
+                regions[TILE_INFO_SIZE * rank + i] = region[i];
+            }
+            if (rank != first_rank)
+            {
+                regions[TILE_INFO_SIZE * rank + 2] = 0;
+                regions[TILE_INFO_SIZE * rank + 3] = 0;
+            }
+        }
+        return;
+    }
+
+    int first_ranks = ranks / 2;
+    bool across = region[2] >= region[3];
+
+    std::vector<double> lines;
+    lineCosts(grid, region, across, lines);
+
+    double total = 0.0;
+    for (size_t line = 0; line < lines.size(); line++)
+    {
+        total += lines[line];
+    }
+
+    //Find the split that comes closest to giving the first half of the
+    //ranks their share of the cost. Without any cost, fall back on an
+    //even split of the pixels.
+    int count = lines.size();
+    int split = (count * first_ranks) / ranks;
+    if (total > 0.0)
+    {
+        double target = total * first_ranks / ranks;
+        double before = 0.0;
+        double best = target;
+
+        split = 0;
+        for (int line = 0; line < count; line++)
+        {
+            before += lines[line];
+            double miss = (before > target) ? before - target : target - before;
+            if (miss < best)
+            {
+                best = miss;
+                split = line + 1;
+            }
+        }
+    }
+
+    int first[TILE_INFO_SIZE] = { region[0], region[1], region[2], region[3] };
+    int second[TILE_INFO_SIZE] = { region[0], region[1], region[2], region[3] };
+    if (across)
+    {
+        first[2] = split;
+        second[0] += split;
+        second[2] -= split;
+    }
+    else
+    {
+        first[3] = split;
+        second[1] += split;
+        second[3] -= split;
+    }
+
+    splitRegion(grid, first, first_rank, first_ranks, regions);
+    splitRegion(grid, second, first_rank + first_ranks, ranks - first_ranks, regions);
+}
+
+void costPartition(ConfigData* data, int spacing, Decomposition* decomposition)
+{
+    CostGrid grid;
+    grid.spacing = spacing;
+    grid.columns = (data->width + spacing - 1) / spacing;
+    grid.rows = (data->height + spacing - 1) / spacing;
+
+    std::vector<float> cells(grid.columns * grid.rows, 0.0f);
+    grid.cells = &(cells[0]);
+
+    //The rows of cells are dealt out to the processes round robin, so
+    //that each one samples every part of the image.
+    int sample_rows = 0;
+    for (int row = data->mpi_rank; row < grid.rows; row += data->mpi_procs)
+    {
+        sample_rows++;
+    }
+
+    parallelFor(sample_rows, data, [&](int index, ConfigData* scene)
+    {
+        int cell_row = data->mpi_rank + index * data->mpi_procs;
+        int row = std::min(cell_row * spacing + spacing / 2, data->height - 1);
+
+        for (int cell_column = 0; cell_column < grid.columns; cell_column++)
+        {
+            int column = std::min(cell_column * spacing + spacing / 2, data->width - 1);
+            float color[3];
+
+            unsigned long long start = readCycleCounter();
+            shadePixel(color, row, column, scene);
+            grid.cells[cell_row * grid.columns + cell_column] = (float)(readCycleCounter() - start);
+        }
+    });
+
+    MPI_Allreduce(MPI_IN_PLACE, grid.cells, cells.size(), MPI_FLOAT, MPI_SUM, MPI_COMM_WORLD);
+
+    std::vector<int> regions(TILE_INFO_SIZE * data->mpi_procs);
+    int image[TILE_INFO_SIZE] = { 0, 0, data->width, data->height };
+    splitRegion(&grid, image, 0, data->mpi_procs, &(regions[0]));
+
+    startDecomposition(data->mpi_procs, decomposition);
+    for (int rank = 0; rank < data->mpi_procs; rank++)
+    {
+        int *region = &(regions[TILE_INFO_SIZE * rank]);
+        addRect(decomposition, region[0], region[1], region[2], region[3]);
+        nextRank(decomposition);
+    }
+}
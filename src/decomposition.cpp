@@ -0,0 +1,189 @@
+//This file contains the decompositions of the static partitioning
+//schemes.
+
+#include <math.h>
+#include <algorithm>
+#include "decomposition.h"
+#include "costmodel.h"
+#include "protocol.h"
+#include "traversal.h"
+
+void evenSplit(int total, int parts, int part, int* start, int* count)
+{
+    int each = total / parts;
+    int remaining = total % parts;
+
+    *count = each + ((part < remaining) ? 1 : 0);
+    *start = part * each + ((part < remaining) ? part : remaining);
+}
+
+void gridShape(int procs, int width, int height, int* columns, int* rows)
+{
+    //Try every way of factoring the processes and keep the one whose
+    //cells come closest to square.
+    double best = -1.0;
+    for (int divisor = 1; divisor <= procs; divisor++)
+    {
+        if (procs % divisor != 0)
+        {
+            continue;
+        }
+
+        double cell_width = (double)width / divisor;
+        double cell_height = (double)height / (procs / divisor);
+        double miss = fabs(log(cell_width / cell_height));
+
+        if (best < 0.0 || miss < best)
+        {
+            best = miss;
+            *columns = divisor;
+            *rows = procs / divisor;
+        }
+    }
+}
+
+void startDecomposition(int procs, Decomposition* decomposition)
+{
+    decomposition->procs = procs;
+    decomposition->rects.clear();
+    decomposition->first.assign(1, 0);
+}
+
+void addRect(Decomposition* decomposition, int start_column, int start_row, int columns, int rows)
+{
+    if (columns <= 0 || rows <= 0)
+    {
+        return;
+    }
+
+    decomposition->rects.push_back(start_column);
+    decomposition->rects.push_back(start_row);
+    decomposition->rects.push_back(columns);
+    decomposition->rects.push_back(rows);
+}
+
+void nextRank(Decomposition* decomposition)
+{
+    decomposition->first.push_back(decomposition->rects.size() / TILE_INFO_SIZE);
+}
+
+void staticDecomposition(ConfigData* data, int costSpacing, Decomposition* decomposition)
+{
+    int procs = data->mpi_procs;
+
+    if (data->partitioningMode == PART_MODE_STATIC_BLOCKS && costSpacing > 0)
+    {
+        costPartition(data, costSpacing, decomposition);
+        return;
+    }
+
+    //Every static scheme is a grid of rectangles; the cycles use bands
+    //that wrap around the processes.
+    int grid_columns = 1, grid_rows = 1;
+    switch (data->partitioningMode)
+    {
+        case PART_MODE_STATIC_STRIPS_HORIZONTAL:
+            grid_rows = procs;
+            break;
+        case PART_MODE_STATIC_STRIPS_VERTICAL:
+            grid_columns = procs;
+            break;
+        case PART_MODE_STATIC_BLOCKS:
+            gridShape(procs, data->width, data->height, &grid_columns, &grid_rows);
+            break;
+        default:
+            break;
+    }
+
+    startDecomposition(procs, decomposition);
+    for (int rank = 0; rank < procs; rank++)
+    {
+        if (data->partitioningMode == PART_MODE_STATIC_CYCLES_HORIZONTAL)
+        {
+            for (int row = rank * data->cycleSize; row < data->height; row += data->cycleSize * procs)
+            {
+                int rows = (row + data->cycleSize <= data->height) ? data->cycleSize : data->height - row;
+                addRect(decomposition, 0, row, data->width, rows);
+            }
+        }
+        else if (data->partitioningMode == PART_MODE_STATIC_CYCLES_VERTICAL)
+        {
+            for (int column = rank * data->cycleSize; column < data->width; column += data->cycleSize * procs)
+            {
+                int columns = (column + data->cycleSize <= data->width) ? data->cycleSize : data->width - column;
+                addRect(decomposition, column, 0, columns, data->height);
+            }
+        }
+        else
+        {
+            int start_column, columns, start_row, rows;
+            evenSplit(data->width, grid_columns, rank % grid_columns, &start_column, &columns);
+            evenSplit(data->height, grid_rows, rank / grid_columns, &start_row, &rows);
+            addRect(decomposition, start_column, start_row, columns, rows);
+        }
+        nextRank(decomposition);
+    }
+}
+
+int rowSegments(Decomposition* decomposition, int rank, std::vector<int>& segments)
+{
+    segments.clear();
+
+    int offset = 0;
+    for (int rect = decomposition->first[rank]; rect < decomposition->first[rank + 1]; rect++)
+    {
+        int *bounds = &(decomposition->rects[TILE_INFO_SIZE * rect]);
+        for (int row = bounds[1]; row < bounds[1] + bounds[3]; row++)
+        {
+            segments.push_back(bounds[0]);
+            segments.push_back(row);
+            segments.push_back(bounds[2]);
+            segments.push_back(offset);
+            offset += bounds[2];
+        }
+    }
+
+    return offset;
+}
+
+int rankWork(Decomposition* decomposition, int rank, TraversalOrder order, std::vector<int>& work)
+{
+    work.clear();
+
+    int offset = 0;
+    std::vector<int> tiles;
+    for (int rect = decomposition->first[rank]; rect < decomposition->first[rank + 1]; rect++)
+    {
+        int *bounds = &(decomposition->rects[TILE_INFO_SIZE * rect]);
+
+        //Rows are tiles that are a single row high.
+        int tile_width = bounds[2];
+        int tile_height = 1;
+        if (order != ORDER_ROWS)
+        {
+            tile_width = TRAVERSAL_TILE_SIZE;
+            tile_height = TRAVERSAL_TILE_SIZE;
+        }
+
+        int tiles_across = (bounds[2] + tile_width - 1) / tile_width;
+        int tiles_down = (bounds[3] + tile_height - 1) / tile_height;
+        curveOrder(tiles_across, tiles_down, order, tiles);
+
+        for (size_t index = 0; index < tiles.size(); index++)
+        {
+            int column = (tiles[index] % tiles_across) * tile_width;
+            int row = (tiles[index] / tiles_across) * tile_height;
+
+            work.push_back(bounds[0] + column);
+            work.push_back(bounds[1] + row);
+            work.push_back(std::min(tile_width, bounds[2] - column));
+            work.push_back(std::min(tile_height, bounds[3] - row));
+            work.push_back(offset + row * bounds[2] + column);
+            work.push_back(bounds[2]);
+        }
+
+        offset += bounds[2] * bounds[3];
+    }
+
+    return offset;
+}
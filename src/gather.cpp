@@ -0,0 +1,152 @@
+//This file contains the gather of the slaves' pixels on the master.
+
+#include <algorithm>
+#include "gather.h"
+#include "protocol.h"
+#include "wire.h"
+
+MPI_Datatype decompositionType(ConfigData* data, Decomposition* decomposition, int proc)
+{
+    std::vector<int> segments;
+    rowSegments(decomposition, proc, segments);
+
+    //Every row of every rectangle is a run of floats in the image.
+    int count = segments.size() / TILE_INFO_SIZE;
+    int *lengths = new int[count];
+    int *displacements = new int[count];
+
+    for (int index = 0; index < count; index++)
+    {
+        int *segment = &(segments[TILE_INFO_SIZE * index]);
+        lengths[index] = 3 * segment[2];
+        displacements[index] = 3 * (segment[1] * data->width + segment[0]);
+    }
+
+    MPI_Datatype pixels;
+    MPI_Type_indexed(count, lengths, displacements, MPI_FLOAT, &pixels);
+    MPI_Type_commit(&pixels);
+
+    delete[] lengths;
+    delete[] displacements;
+
+    return pixels;
+}
+
+void startGather(ConfigData* data, float* pixels, Decomposition* decomposition, SlaveGather* gather)
+{
+    int slaves = data->mpi_procs - 1;
+
+    gather->procs = data->mpi_procs;
+    gather->width = data->width;
+    gather->pixels = pixels;
+    gather->decomposition = decomposition;
+    gather->types = NULL;
+    gather->buffers = NULL;
+    gather->times = new double[data->mpi_procs];
+    gather->requests = new MPI_Request[2 * slaves];
+
+    if (wireFormat() != WIRE_FLOAT)
+    {
+        gather->buffers = new unsigned char*[data->mpi_procs];
+    }
+    else
+    {
+        gather->types = new MPI_Datatype[data->mpi_procs];
+    }
+
+    for (int proc = 1; proc < data->mpi_procs; proc++)
+    {
+        if (gather->buffers != NULL)
+        {
+            std::vector<int> segments;
+            int bytes = wireBytes(3 * rowSegments(decomposition, proc, segments));
+
+            gather->buffers[proc] = new unsigned char[bytes];
+            MPI_Irecv(gather->buffers[proc], bytes, MPI_BYTE, proc, TAG_DATA, MPI_COMM_WORLD, &(gather->requests[proc - 1]));
+        }
+        else
+        {
+            gather->types[proc] = decompositionType(data, decomposition, proc);
+            MPI_Irecv(pixels, 1, gather->types[proc], proc, TAG_DATA, MPI_COMM_WORLD, &(gather->requests[proc - 1]));
+        }
+        MPI_Irecv(&(gather->times[proc]), 1, MPI_DOUBLE, proc, TAG_DATA, MPI_COMM_WORLD, &(gather->requests[slaves + proc - 1]));
+    }
+}
+
+double finishGather(SlaveGather* gather, double* rank_times)
+{
+    int slaves = gather->procs - 1;
+
+    //The slaves' pixels are put in place in the order they arrive.
+    for (int received = 0; received < slaves; received++)
+    {
+        int index;
+        MPI_Waitany(slaves, gather->requests, &index, MPI_STATUS_IGNORE);
+        int proc = index + 1;
+
+        std::vector<int> segments;
+        int values = 3 * rowSegments(gather->decomposition, proc, segments);
+        countWireBytes(proc, wireBytes(values));
+
+        if (gather->buffers == NULL)
+        {
+            MPI_Type_free(&(gather->types[proc]));
+            continue;
+        }
+
+        //Every row is decoded straight into the image.
+        for (size_t segment = 0; segment < segments.size(); segment += TILE_INFO_SIZE)
+        {
+            int *row = &(segments[segment]);
+            decodePixels(&(gather->buffers[proc][wireBytes(3 * row[3])]), 3 * row[2],
+                         &(gather->pixels[3 * (row[1] * gather->width + row[0])]));
+        }
+
+        delete[] gather->buffers[proc];
+    }
+
+    MPI_Waitall(slaves, &(gather->requests[slaves]), MPI_STATUSES_IGNORE);
+
+    double computationTime = 0.0;
+    for (int proc = 1; proc < gather->procs; proc++)
+    {
+        if (gather->times[proc] > computationTime)
+        {
+            computationTime = gather->times[proc];
+        }
+        if (rank_times != NULL)
+        {
+            rank_times[proc] = gather->times[proc];
+        }
+    }
+
+    delete[] gather->buffers;
+    delete[] gather->types;
+    delete[] gather->times;
+    delete[] gather->requests;
+
+    return computationTime;
+}
+
+double collectSlaveStats(ConfigData* data, int values, double* stats, double* communicationTime)
+{
+    double computationTime = 0.0;
+    *communicationTime = 0.0;
+
+    double *received = new double[values];
+    for (int proc = 1; proc < data->mpi_procs; proc++)
+    {
+        MPI_Recv(received, values, MPI_DOUBLE, proc, TAG_DATA, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+        computationTime = std::max(computationTime, received[0]);
+        *communicationTime = std::max(*communicationTime, received[1]);
+
+        if (stats != NULL)
+        {
+            std::copy(received, received + values, &(stats[values * proc]));
+        }
+    }
+    delete[] received;
+
+    return computationTime;
+}
@@ -13,6 +13,10 @@ using namespace std;
 #include "RayTrace.h"
 #include "master.h"
 #include "slave.h"
+#include "options.h"
+#include "renderpool.h"
+#include "scenestage.h"
+#include "allocations.h"
 
 int main( int argc, char* argv[] ) 
 {
@@ -21,7 +25,9 @@ int main( int argc, char* argv[] )
     int rank;
     int max_rank;
     
-    MPI_Init(&argc, &argv);
+    //Only the main thread makes MPI calls; the render threads just shade.
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &max_rank);
 
@@ -29,15 +35,64 @@ int main( int argc, char* argv[] )
 
     data.mpi_rank = rank;
     data.mpi_procs = max_rank;
+
+    //Pull out the parameters that only the MPI program understands.
+    RunOptions options;
+    if( parseRunOptions(&argc, &argv, &options) )
+    {
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    //Render threads need an MPI library that tolerates them next to the
+    //main thread.
+    if( options.threads > 1 && provided < MPI_THREAD_FUNNELED )
+    {
+        if( rank == 0 )
+        {
+            cout << "The MPI library does not support threads; rendering with 1 thread instead." << endl;
+        }
+        options.threads = 1;
+    }
     
+    //Keep the arguments around; every render thread loads its own scene.
+    int scene_argc = argc;
+    char** scene_argv = new char*[argc + 1];
+    for( int i = 0; i <= argc; ++i )
+    {
+        scene_argv[i] = argv[i];
+    }
+
+    //Load the scene from a copy on the node instead of shared storage.
+    SceneStage stage;
+    stage.active = false;
+    stage.node = MPI_COMM_NULL;
+    if( options.stage )
+    {
+        stageScene(argc, argv, &stage);
+    }
+
     //Try to initialize the scene.
+    double loadStart = MPI_Wtime();
+    enableSceneArena(options.arena);
+    useSceneArena(true);
     bool result = initialize(&argc, &argv, &data);
+    useSceneArena(false);
     //Make sure that the initialization was completed.	
     if( result )
     {
         MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
     }
 
+    if( startRenderThreads(options.threads, scene_argc, scene_argv, &data) )
+    {
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    double loadTime = MPI_Wtime() - loadStart;
+
+    //Every scene is loaded, so the staged copy is no longer needed.
+    finishStaging(&stage);
+
     //Insert the MPI intialization code here.
 
     if( data.mpi_rank == 0 )
@@ -67,14 +122,28 @@ int main( int argc, char* argv[] )
         std::cout << "Cycle Size: " << data.cycleSize << std::endl; 
 
         //Start the main processing for the ray tracer.
-        masterMain( &data );
+        masterMain( &data, &options );
     }
     else
     {
-        slaveMain( &data );
+        slaveMain( &data, &options );
+    }
+
+    //The scene statistics follow the rest of the report.
+    if( data.mpi_rank == 0 )
+    {
+        //Every render thread loaded the scene files once.
+        double sceneBytes = (double)sceneSize(scene_argc, scene_argv) * options.threads;
+        std::cout << "Scene Load Time: " << loadTime << " seconds (" << sceneBytes / loadTime / 1.0e6 << " MB/s)" << std::endl;
+        if( options.arena )
+        {
+            std::cout << "Scene Arena: " << sceneArenaBytes() << " bytes" << std::endl;
+        }
     }
 
     //Clean up the scene and other data.
+    stopRenderThreads();
+    delete[] scene_argv;
     shutdown(&data);
     MPI_Finalize();
     return 0;
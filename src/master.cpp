@@ -3,23 +3,142 @@
 #include <iostream>
 #include <mpi.h>
 #include<math.h>
+#include <algorithm>
+#include <vector>
 #include "RayTrace.h"
 #include "master.h"
+#include "protocol.h"
+#include "tiles.h"
+#include "gather.h"
+#include "wire.h"
+#include "allocations.h"
+#include "profile.h"
+#include "decomposition.h"
+#include "traversal.h"
+#include "cachemisses.h"
+#include "regionbuffer.h"
+
+//This function prints how the computation time was spread over the
+//processes that did the rendering, so that partitioning schemes can be
+//compared by more than their slowest process.
+//
+//Inputs:
+//    rank_times - the computation time of every process
+//    rank_tiles - the number of tiles every process rendered, or NULL
+//    first_rank - the first process that did any rendering
+//    procs - the number of processes
+static void printLoadBalance(double* rank_times, int* rank_tiles, int first_rank, int procs)
+{
+    double max_time = 0.0;
+    double total_time = 0.0;
+
+    std::cout << "Load Balance:" << std::endl;
+    for (int rank = first_rank; rank < procs; rank++)
+    {
+        std::cout << "    Rank " << rank << ": " << rank_times[rank] << " seconds";
+        if (rank_tiles != NULL)
+        {
+            std::cout << ", " << rank_tiles[rank] << " tiles";
+        }
+        std::cout << std::endl;
+
+        if (rank_times[rank] > max_time)
+        {
+            max_time = rank_times[rank];
+        }
+        total_time += rank_times[rank];
+    }
 
-void masterMain(ConfigData* data)
+    double mean_time = total_time / (procs - first_rank);
+    std::cout << "Load Imbalance (max / mean): " << max_time / mean_time << std::endl;
+}
+
+void masterMain(ConfigData* data, RunOptions* options)
 {
     //Depending on the partitioning scheme, different things will happen.
     //You should have a different function for each of the required 
     //schemes that returns some values that you need to handle.
     
-    //Allocate space for the image on the master.
-    float* pixels = new float[3 * data->width * data->height];
+    //The master only hands out work with dynamic partitioning, so there
+    //has to be at least one slave to do the rendering. Without one there
+    //is no image to save, and no other process to wait for.
+    if (data->partitioningMode == PART_MODE_DYNAMIC && data->mpi_procs < 2)
+    {
+        std::cout << "Dynamic partitioning requires at least 2 processes." << std::endl;
+        return;
+    }
+
+    setWireFormat(options->wire, data->mpi_procs);
+    setTraversalOrder(options->order);
+
+    //When streaming, the image is written while it is being rendered,
+    //so the master never allocates the whole frame.
+    bool streaming = options->stream;
+    if (streaming && (data->partitioningMode != PART_MODE_DYNAMIC || options->scheduler != SCHED_FIXED))
+    {
+        std::cout << "Streaming is only supported with dynamic partitioning and the fixed scheduler;" << std::endl;
+        std::cout << "the image will be saved after rendering instead." << std::endl;
+        streaming = false;
+    }
+
+    //Only static blocks can be sized by their cost.
+    if (options->costSpacing > 0 && data->partitioningMode != PART_MODE_STATIC_BLOCKS)
+    {
+        std::cout << "The cost model is only supported with static blocks;" << std::endl;
+        std::cout << "the image will be partitioned without it." << std::endl;
+    }
+
+    //The collective gather only collects horizontal strips, and only
+    //into an image in memory.
+    if (options->gather == GATHER_COLLECTIVE &&
+        (data->partitioningMode != PART_MODE_STATIC_STRIPS_HORIZONTAL || options->outOfCore > 0))
+    {
+        std::cout << "The collective gather is only supported with static horizontal strips in memory;" << std::endl;
+        std::cout << "the image will be collected without it." << std::endl;
+    }
+
+    PngStream stream;
+    std::string file = generateFileName(data);
+    if (streaming)
+    {
+        if (openPngStream(file, data, &stream))
+        {
+            std::cout << "The image will be saved after rendering instead." << std::endl;
+            streaming = false;
+        }
+    }
+
+    //A band can only be written once all of its tiles are in, so the
+    //tiles are handed out row by row when streaming; a curve order would
+    //keep most of the image buffered. The slaves of the fixed scheduler
+    //only see tile bounds, so they do not need to know.
+    if (streaming && options->order != ORDER_ROWS)
+    {
+        std::cout << "Streaming hands out the tiles row by row; the traversal order only applies" << std::endl;
+        std::cout << "within every tile." << std::endl;
+        orderTiles(data, ORDER_ROWS);
+    }
+    else
+    {
+        orderTiles(data, options->order);
+    }
+
+    //Set up the image on the master, in memory or on disk.
+    OutputImage image;
+    if (!streaming)
+    {
+        openOutputImage(data, file, options->outOfCore, &image);
+    }
 
     //Execution time will be defined as how long it takes
     //for the given function to execute based on partitioning
     //type.
     double renderTime = 0.0, startTime, stopTime;
 
+    countAllocations(options->allocations);
+    countCacheMisses(options->cacheMisses);
+    startProfile(data, options->profile);
+
 	//Add the required partitioning methods here in the case statement.
 	//You do not need to handle all cases; the default will catch any
 	//statements that are not specified. This switch/case statement is the
@@ -33,31 +152,44 @@ void masterMain(ConfigData* data)
         case PART_MODE_NONE:
             //Call the function that will handle this.
             startTime = MPI_Wtime();
-            masterSequential(data, pixels);
+            masterSequential(data, &image);
             stopTime = MPI_Wtime();
             break;
         case PART_MODE_STATIC_STRIPS_HORIZONTAL:
-
-            startTime = MPI_Wtime();
-            masterMPI_Horizontal(data, pixels);
-            stopTime  = MPI_Wtime();
-            break;
         case PART_MODE_STATIC_STRIPS_VERTICAL:
-
-            startTime = MPI_Wtime();
-            masterMPI_Vertical(data, pixels);
-            stopTime = MPI_Wtime();
-            break;
         case PART_MODE_STATIC_BLOCKS:
+        case PART_MODE_STATIC_CYCLES_HORIZONTAL:
+        case PART_MODE_STATIC_CYCLES_VERTICAL:
 
+            //All of the static schemes share one code path; they only
+            //differ in how the image is decomposed. An image on disk is
+            //collected in pieces, which the collective gather cannot do.
             startTime = MPI_Wtime();
-            masterMPI_Block(data, pixels);
+            if (data->partitioningMode == PART_MODE_STATIC_STRIPS_HORIZONTAL && options->gather == GATHER_COLLECTIVE && options->outOfCore == 0)
+            {
+                masterMPI_HorizontalCollective(data, &image);
+            }
+            else
+            {
+                masterStatic(data, &image, options->costSpacing);
+            }
             stopTime = MPI_Wtime();
             break;
-        case PART_MODE_STATIC_CYCLES_VERTICAL:
+        case PART_MODE_DYNAMIC:
 
             startTime = MPI_Wtime();
-            masterCyclesV(data, pixels);
+            if (streaming)
+            {
+                masterStreaming(data, &stream);
+            }
+            else if (options->scheduler == SCHED_GUIDED)
+            {
+                masterGuided(data, &image);
+            }
+            else
+            {
+                masterDynamic(data, &image);
+            }
             stopTime = MPI_Wtime();
             break;
 
@@ -67,38 +199,87 @@ void masterMain(ConfigData* data)
             break;
     }
 
+    stopProfile(data);
+
     renderTime = stopTime - startTime;
     std::cout << "Execution Time: " << renderTime << " seconds" << std::endl << std::endl;
 
+    printWireBytes();
+
+    //Every process adds in the allocations it made while rendering.
+    if (options->allocations)
+    {
+        countAllocations(false);
+
+        long long processAllocations = allocationCount();
+        long long totalAllocations = 0;
+        MPI_Reduce(&processAllocations, &totalAllocations, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        std::cout << "Heap Allocations: " << totalAllocations << " (";
+        std::cout << (double)totalAllocations / ((double)data->width * data->height) << " per pixel)" << std::endl << std::endl;
+    }
+
+    //The same goes for the cache misses; a single process without
+    //counters makes the total meaningless.
+    if (options->cacheMisses)
+    {
+        countCacheMisses(false);
+
+        long long processCounts[3] = { cacheMissCount(), cacheReferenceCount(), cacheMissesAvailable() ? 0 : 1 };
+        long long totalCounts[3];
+        MPI_Reduce(processCounts, totalCounts, 3, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        if (totalCounts[2] > 0)
+        {
+            std::cout << "Cache Misses: not available (the hardware counters could not be opened)" << std::endl << std::endl;
+        }
+        else
+        {
+            std::cout << "Cache Misses: " << totalCounts[0] << " of " << totalCounts[1] << " references (";
+            std::cout << (totalCounts[1] > 0 ? 100.0 * totalCounts[0] / totalCounts[1] : 0.0) << "%, ";
+            std::cout << (double)totalCounts[0] / ((double)data->width * data->height) << " per pixel)" << std::endl << std::endl;
+        }
+    }
+
+    //A streamed image only needs the end of the file written.
+    if (streaming)
+    {
+        std::cout << "Image was streamed to: " << file << std::endl;
+        closePngStream(&stream);
+        writeProfile(data, file);
+        return;
+    }
+
     //After this gets done, save the image.
     std::cout << "Image will be save to: ";
-    std::string file = generateFileName(data);
     std::cout << file << std::endl;
-    savePixels(file, pixels, data);
+    saveOutputImage(&image, file, data);
+    writeProfile(data, file);
 
     //Delete the pixel data.
-    delete[] pixels; 
+    closeOutputImage(&image);
 }
 
-void masterSequential(ConfigData* data, float* pixels)
+void masterSequential(ConfigData* data, OutputImage* image)
 {
     //Start the computation time timer.
     double computationStart = MPI_Wtime();
 
-    //Render the scene.
-    for( int i = 0; i < data->height; ++i )
-    {
-        for( int j = 0; j < data->width; ++j )
-        {
-            int row = i;
-            int column = j;
-
-            //Calculate the index into the array.
-            int baseIndex = 3 * ( row * data->width + column );
+    //The whole image is a single rectangle, cut into rows or tiles
+    //depending on the traversal order.
+    Decomposition decomposition;
+    startDecomposition(1, &decomposition);
+    addRect(&decomposition, 0, 0, data->width, data->height);
+    nextRank(&decomposition);
 
-            //Call the function to shade the pixel.
-            shadePixel(&(pixels[baseIndex]),row,column,data);
-        }
+    //An image on disk is rendered a band at a time.
+    if (image->bufferValues > 0)
+    {
+        renderRegionBands(&decomposition, 0, data, image);
+    }
+    else
+    {
+        renderRegionInPlace(&decomposition, 0, data, image->pixels);
     }
 
     //Stop the comp. timer
@@ -119,78 +300,70 @@ void masterSequential(ConfigData* data, float* pixels)
 }
 
 
-void masterMPI_Horizontal(ConfigData *data, float *pixels)
+void masterStatic(ConfigData *data, OutputImage *image, int costSpacing)
 {
-
-    MPI_Status status;
+    //Building the decomposition counts as computation, since with the
+    //cost model it includes the pre-pass.
     double computationStart = MPI_Wtime();
 
-    int rows_per_process = data->height / data->mpi_procs;
-    int avg_per_process = rows_per_process;
+    Decomposition decomposition;
+    staticDecomposition(data, costSpacing, &decomposition);
 
-    int remaining_this_process = data->height % data->mpi_procs;
-    int remaining = remaining_this_process;
-    if (remaining > data->mpi_rank)
+    double estimateTime = MPI_Wtime() - computationStart;
+
+    //An image on disk is filled in a piece at a time; the master renders
+    //its share first and then takes the slaves' pieces one after the
+    //other.
+    bool pieces = image->bufferValues > 0;
+
+    //Otherwise the receives for the slaves' pixels are posted before
+    //rendering, so that they can come in while the master is still busy
+    //with its own.
+    SlaveGather gather;
+    if (!pieces)
     {
-        rows_per_process++;
+        startGather(data, image->pixels, &decomposition, &gather);
     }
 
-    for (int i = 0; i < rows_per_process; i++)
+    //The master's own pixels go straight into the image when it is in
+    //memory.
+    if (pieces)
     {
-        for (int j = 0; j < data->height; j++)
-        {
-            int row = i;
-            int column = j;
-            int baseIndex = 3 * (row * data->width + column);
-            shadePixel(&(pixels[baseIndex]), row, column, data);
-        }
+        renderRegionBands(&decomposition, data->mpi_rank, data, image);
+    }
+    else
+    {
+        renderRegionInPlace(&decomposition, data->mpi_rank, data, image->pixels);
     }
-
-    int next = rows_per_process;
 
     double computationStop = MPI_Wtime();
     double computationTime = computationStop - computationStart;
 
+    double *rank_times = new double[data->mpi_procs];
+    rank_times[0] = computationTime;
+
     double communicationStart = MPI_Wtime();
 
-    for (int proc = 1; proc < data->mpi_procs; proc++)
+    double slaveTime = 0.0;
+    if (pieces)
     {
-
-        int rows_in_single_process = avg_per_process;
-
-        if (proc < remaining_this_process)
+        float *scratch = new float[image->bufferValues];
+        for (int proc = 1; proc < data->mpi_procs; proc++)
         {
-            rows_in_single_process++;
+            receiveRegion(&decomposition, proc, image, scratch);
+            MPI_Recv(&(rank_times[proc]), 1, MPI_DOUBLE, proc, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            slaveTime = std::max(slaveTime, rank_times[proc]);
         }
+        delete[] scratch;
+    }
+    else
+    {
+        slaveTime = finishGather(&gather, rank_times);
+    }
 
-        int total_pixels = 3 * data->width * rows_per_process;
-
-        double comm_recv_buf = 0.0;
-
-        float *proc_pixels = new float[total_pixels];
-
-        MPI_Recv(proc_pixels, total_pixels, MPI_FLOAT, proc, 0, MPI_COMM_WORLD, &status);
-        MPI_Recv(&comm_recv_buf, 1, MPI_DOUBLE, proc, 0, MPI_COMM_WORLD, &status);
-
-        if (comm_recv_buf > computationTime)
-        {
-            computationTime = comm_recv_buf;
-        }
-
-        for (int row = 0; row < rows_in_single_process; row++)
-        {
-            for (int column = 0; column < data->height; column++)
-            {
-
-                int baseIndex = 3 * (next * data->width + column);
-                int procIndex = 3 * (row * data->width + column);
-
-                pixels[baseIndex] = proc_pixels[procIndex];
-                pixels[baseIndex + 1] = proc_pixels[procIndex + 1];
-                pixels[baseIndex + 2] = proc_pixels[procIndex + 2];
-            }
-            next++;
-        }
+    if (slaveTime > computationTime)
+    {
+        computationTime = slaveTime;
     }
 
     double communicationStop = MPI_Wtime();
@@ -200,193 +373,170 @@ void masterMPI_Horizontal(ConfigData *data, float *pixels)
     std::cout << "Total Communication Time: " << communicationTime << " seconds" << std::endl;
     double c2cRatio = communicationTime / computationTime;
     std::cout << "C-to-C Ratio: " << c2cRatio << std::endl;
-}
 
-void masterMPI_Vertical(ConfigData *data, float *pixels)
-{
+    //The blocks are only worth listing when they are not a plain grid.
+    if (data->partitioningMode == PART_MODE_STATIC_BLOCKS && costSpacing > 0)
+    {
+        std::cout << "Cost Estimate Time: " << estimateTime << " seconds" << std::endl;
+        std::cout << "Blocks:" << std::endl;
+        for (int proc = 0; proc < data->mpi_procs; proc++)
+        {
+            std::cout << "    Rank " << proc << ": ";
+            if (decomposition.first[proc] == decomposition.first[proc + 1])
+            {
+                std::cout << "none" << std::endl;
+                continue;
+            }
 
-    MPI_Status status;
-    double computationStart = MPI_Wtime();
+            int *bounds = &(decomposition.rects[TILE_INFO_SIZE * decomposition.first[proc]]);
+            std::cout << bounds[2] << " x " << bounds[3];
+            std::cout << " at (" << bounds[0] << ", " << bounds[1] << ")" << std::endl;
+        }
+    }
 
+    printLoadBalance(rank_times, NULL, 0, data->mpi_procs);
+    delete[] rank_times;
+}
 
-    int columns_per_process = (data->width) / (data->mpi_procs);
-    int avg_per_process = columns_per_process;
+void masterMPI_HorizontalCollective(ConfigData *data, OutputImage *image)
+{
+    float *pixels = image->pixels;
 
-    int remaining_this_process = data->width % data->mpi_procs;
-    int remaining = remaining_this_process;
-    if (remaining > data->mpi_rank)
-    {             
-        columns_per_process++;     
-    }
+    double computationStart = MPI_Wtime();
 
-    for (int i = 0; i < data->width; i++)
-    { 
-        for (int j = 0; j < columns_per_process; j++)
-        { 
-            int row = i;
-            int column = j;
-            int baseIndex = 3 * (row * data->width + column);
-            shadePixel(&(pixels[baseIndex]), row, column, data); 
-        }
-    }
+    Decomposition decomposition;
+    staticDecomposition(data, 0, &decomposition);
 
-    int next = columns_per_process;
+    renderRegionInPlace(&decomposition, data->mpi_rank, data, pixels);
 
     double computationStop = MPI_Wtime();
     double computationTime = computationStop - computationStart;
 
-    
     double communicationStart = MPI_Wtime();
 
-    for (int proc = 1; proc < data->mpi_procs; proc++)
+    //Every strip is contiguous in the image, so the slaves' strips can
+    //be gathered straight into place behind the master's own.
+    int *counts = new int[data->mpi_procs];
+    int *displacements = new int[data->mpi_procs];
+    for (int proc = 0; proc < data->mpi_procs; proc++)
     {
+        //A strip is missing when there are more processes than rows;
+        //those are the last ones, at the end of the image.
+        counts[proc] = 0;
+        displacements[proc] = 3 * data->width * data->height;
 
-        int columns_in_single_process = avg_per_process;
+        if (decomposition.first[proc] < decomposition.first[proc + 1])
+        {
+            int *strip = &(decomposition.rects[TILE_INFO_SIZE * decomposition.first[proc]]);
+            counts[proc] = 3 * data->width * strip[3];
+            displacements[proc] = 3 * data->width * strip[1];
+        }
+    }
 
-        if (proc < remaining_this_process)
-        {                
-            columns_in_single_process++; 
+    if (wireFormat() == WIRE_FLOAT)
+    {
+        MPI_Gatherv(MPI_IN_PLACE, 0, MPI_FLOAT, pixels, counts, displacements, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    }
+    else
+    {
+        //The encoded strips of the slaves are gathered behind each other
+        //and decoded into the image in one go, since they are in the
+        //same order there.
+        int slave_values = 3 * data->width * data->height - counts[0];
+        unsigned char *buffer = new unsigned char[wireBytes(slave_values)];
+
+        int *byte_counts = new int[data->mpi_procs];
+        int *byte_displacements = new int[data->mpi_procs];
+        byte_counts[0] = 0;
+        byte_displacements[0] = 0;
+        for (int proc = 1; proc < data->mpi_procs; proc++)
+        {
+            byte_counts[proc] = wireBytes(counts[proc]);
+            byte_displacements[proc] = wireBytes(displacements[proc] - counts[0]);
         }
 
-        int total_pixels = 3 * columns_in_single_process * data->height;
+        MPI_Gatherv(buffer, 0, MPI_BYTE, buffer, byte_counts, byte_displacements, MPI_BYTE, 0, MPI_COMM_WORLD);
+        decodePixels(buffer, slave_values, &(pixels[counts[0]]));
 
-        double comm_recv_buf = 0.0;
+        delete[] byte_counts;
+        delete[] byte_displacements;
+        delete[] buffer;
+    }
 
-        float *proc_pixels = new float[total_pixels];
+    for (int proc = 1; proc < data->mpi_procs; proc++)
+    {
+        countWireBytes(proc, wireBytes(counts[proc]));
+    }
 
-        MPI_Recv(proc_pixels, total_pixels, MPI_FLOAT, proc, 0, MPI_COMM_WORLD, &status); 
-        MPI_Recv(&comm_recv_buf, 1, MPI_DOUBLE, proc, 0, MPI_COMM_WORLD, &status);      
+    delete[] counts;
+    delete[] displacements;
 
-        if (comm_recv_buf > computationTime)
-        {                                    
-            computationTime = comm_recv_buf; 
-        }
+    double slowestTime;
+    MPI_Reduce(&computationTime, &slowestTime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    computationTime = slowestTime;
 
-        for (int row = 0; row < (data->height); row++)
-        {
-            next = 0;
-            for (int column = 0; column < columns_in_single_process; column++)
-            { 
-             
-
-                int baseIndex = 3 * (row * data->width + next);
-                int procIndex = 3 * (row * columns_in_single_process + column);
-
-                pixels[baseIndex] = proc_pixels[procIndex];
-                pixels[baseIndex + 1] = proc_pixels[procIndex + 1];
-                pixels[baseIndex + 2] = proc_pixels[procIndex + 2];
-                next++;
-            }
-            
-        }
-    }
-
-  
     double communicationStop = MPI_Wtime();
     double communicationTime = communicationStop - communicationStart;
 
-    
     std::cout << "Total Computation Time: " << computationTime << " seconds" << std::endl;
     std::cout << "Total Communication Time: " << communicationTime << " seconds" << std::endl;
     double c2cRatio = communicationTime / computationTime;
     std::cout << "C-to-C Ratio: " << c2cRatio << std::endl;
 }
 
-void masterMPI_CyclicVertical(ConfigData *data, float *pixels)
+void masterDynamic(ConfigData *data, OutputImage *image)
 {
-
     MPI_Status status;
-    double computationStart = MPI_Wtime();
-
-    int start_cycle = data->cycleSize * data->mpi_rank;
-    int cycle_counter = data->cycleSize *data->mpi_procs; 
-
-    // for (int z = start_cycle; z < data->width; z+=cycle_counter)
-    // {
-    //     for (int i = 0; i < data->height; i++)
-    //     {
-    //         for (int j = z; j < data->width; j++)
-    //         {
-    //             int row = i;
-    //             int column = j;
-    //             if(column < z + data->cycleSize)
-    //             {
-    //                 int baseIndex = 3 * (row * data->width + column);
-    //                 shadePixel(&(pixels[baseIndex]), row, column, data);
-    //             }
-                
-    //         }
-    //     }
-    // }
-
-    for (int cycle = data->mpi_rank * data->cycleSize; cycle < data->width; cycle += data->cycleSize * data->mpi_procs)
-    {
-        for (int column = cycle; (column - cycle < data->cycleSize) && (column < data->width); column++)
-        {
-            for (int row = 0; row < data->height; row++)
-            {
-                //Calculate the index into the array.
-                int baseIndex = 3 * (row * data->width + column);
-                shadePixel(&(pixels[baseIndex]), row, column, data);
-            }
-        }
-    }
 
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
+    int total_blocks = tileCount(data);
+    int next_block = 0;
+    int active_slaves = data->mpi_procs - 1;
 
-    double communicationStart = MPI_Wtime();
+    float *tile_pixels = new float[3 * data->dynamicBlockWidth * data->dynamicBlockHeight];
 
-    for (int proc = 1; proc < data->mpi_procs; proc++)
+    //Every slave starts by asking for work and then sends each finished
+    //tile back along with the request for the next one, so the master
+    //just answers whatever arrives first until the tiles run out.
+    while (active_slaves > 0)
     {
-       
-        int columns_in_single_process = 0;
-        start_cycle = data->cycleSize * proc;
-        for (int z = start_cycle; z < data->width; z += cycle_counter)
-        { 
-            for (int j = z; j < data->width; j++)
-            {
-                int column = j;
-                if (column < z + data->cycleSize)
-                    columns_in_single_process++;
-            }
-        }
+        int tile[TILE_INFO_SIZE];
 
+        //A request carries the tile that the slave just finished, or an
+        //empty tile if this is its first request.
+        MPI_Recv(tile, TILE_INFO_SIZE, MPI_INT, MPI_ANY_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &status);
+        int proc = status.MPI_SOURCE;
 
-        int total_pixels = 3 * columns_in_single_process * data->height;
-        double comm_recv_buf = 0.0;
-        float *proc_pixels = new float[total_pixels];
+        if (tile[2] * tile[3] > 0)
+        {
+            int start_column = tile[0];
+            int start_row = tile[1];
+            int tile_width = tile[2];
+            int tile_height = tile[3];
 
-        MPI_Recv(proc_pixels, total_pixels, MPI_FLOAT, proc, 0, MPI_COMM_WORLD, &status);
-        MPI_Recv(&comm_recv_buf, 1, MPI_DOUBLE, proc, 0, MPI_COMM_WORLD, &status);
+            recvPixels(tile_pixels, 3 * tile_width * tile_height, proc, TAG_RESULT, &status);
+            putPixels(image, tile_pixels, start_column, start_row, tile_width, tile_height, tile_width);
+        }
 
-        int next = 0;
-        for (int cycle = start_cycle; cycle < data->width; cycle+= cycle_counter)
+        if (next_block < total_blocks)
         {
-            for (int column = cycle; column < data->width; column++)
-            {
-                for (int row = 0; row < (data->height); row++)
-                {
+            tileBounds(data, next_block, tile);
+            next_block++;
 
-                    if (column < cycle + data->cycleSize)
-                    {
-                        int baseIndex = 3 * (row * data->width + column);
-                        int procIndex = 3 * (row + next*data->height);
-
-                        pixels[baseIndex] = proc_pixels[procIndex];
-                        pixels[baseIndex + 1] = proc_pixels[procIndex + 1];
-                        pixels[baseIndex + 2] = proc_pixels[procIndex + 2];
-                    }
-                }
-                next++;
-            }
+            MPI_Send(tile, TILE_INFO_SIZE, MPI_INT, proc, TAG_TILE, MPI_COMM_WORLD);
+        }
+        else
+        {
+            MPI_Send(tile, 0, MPI_INT, proc, TAG_TERMINATE, MPI_COMM_WORLD);
+            active_slaves--;
         }
-        
-        
     }
 
-    double communicationStop = MPI_Wtime();
-    double communicationTime = communicationStop - communicationStart;
+    delete[] tile_pixels;
+
+    //The master spends the whole run handing out tiles, so the times that
+    //are reported are the largest ones measured on the slaves.
+    double communicationTime;
+    double computationTime = collectSlaveStats(data, 2, NULL, &communicationTime);
 
     std::cout << "Total Computation Time: " << computationTime << " seconds" << std::endl;
     std::cout << "Total Communication Time: " << communicationTime << " seconds" << std::endl;
@@ -394,211 +544,257 @@ void masterMPI_CyclicVertical(ConfigData *data, float *pixels)
     std::cout << "C-to-C Ratio: " << c2cRatio << std::endl;
 }
 
-void masterMPI_Block(ConfigData *data, float *pixels)
+void masterStreaming(ConfigData *data, PngStream *stream)
 {
-    double computationStart = MPI_Wtime();
-
     MPI_Status status;
-    int each_proc_sqrt = (int)sqrt(data->mpi_procs);
-    int columns_per_process = data->width / each_proc_sqrt;
-    int rows_per_process = data->height / each_proc_sqrt;
 
-    int remaining_columns = data->width % each_proc_sqrt;
-    int remaining_rows = data->height % each_proc_sqrt;
-
-    int start_column = (data->mpi_rank / (each_proc_sqrt)) * columns_per_process;
-    int start_row = (data->mpi_rank % (each_proc_sqrt)) * rows_per_process;
-
-    
-    if (remaining_columns)
-    {
-        if ((data->mpi_rank % each_proc_sqrt) == each_proc_sqrt-1)
-        { 
-            columns_per_process =columns_per_process +  remaining_columns;
-        }
-    }
-    
-    if (remaining_rows)
+    int total_blocks = tileCount(data);
+    int next_block = 0;
+    int active_slaves = data->mpi_procs - 1;
+
+    //Tiles are numbered row by row when streaming (see masterMain), so a
+    //band is one row of tiles. Each band gets a buffer when its first
+    //tile is handed out, and the buffer is encoded and freed once its
+    //last tile has come back and every band above it has been written.
+    int tiles_across = (data->width + data->dynamicBlockWidth - 1) / data->dynamicBlockWidth;
+    int band_count = (data->height + data->dynamicBlockHeight - 1) / data->dynamicBlockHeight;
+    int band_size = 3 * data->width * data->dynamicBlockHeight;
+
+    float **bands = new float*[band_count];
+    int *tiles_left = new int[band_count];
+    for (int band = 0; band < band_count; band++)
     {
-        if (data->mpi_rank / (each_proc_sqrt) == (each_proc_sqrt)-1)
-        { 
-            rows_per_process =rows_per_process +  remaining_rows;
-        }
+        bands[band] = NULL;
+        tiles_left[band] = tiles_across;
     }
 
-    int end_column = start_column + columns_per_process;
-    int end_row = start_row + rows_per_process;
+    int next_band = 0;
+    int buffered_bands = 0;
+    int peak_bands = 0;
+    double encodingTime = 0.0;
 
-    for (int i = start_row; i < end_row; i++)
-    {
-        for (int j = start_column; j < end_column; j++)
-        {         
-            int row = i;
-            int column = j;
-            int baseIndex = 3 * (row * data->width + column);
+    float *tile_pixels = new float[3 * data->dynamicBlockWidth * data->dynamicBlockHeight];
 
-            shadePixel(&(pixels[baseIndex]), row, column, data); 
-        }
-    }
+    while (active_slaves > 0)
+    {
+        int tile[TILE_INFO_SIZE];
 
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
+        MPI_Recv(tile, TILE_INFO_SIZE, MPI_INT, MPI_ANY_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &status);
+        int proc = status.MPI_SOURCE;
 
-    
-    double communicationTime = 0.0;
+        if (tile[2] * tile[3] > 0)
+        {
+            int start_column = tile[0];
+            int tile_width = tile[2];
+            int tile_height = tile[3];
+            int band = tile[1] / data->dynamicBlockHeight;
 
-    for (int proc = 1; proc < data->mpi_procs; proc++)
-    { 
+            recvPixels(tile_pixels, 3 * tile_width * tile_height, proc, TAG_RESULT, &status);
 
-       
-        int proc_columns = data->width / (each_proc_sqrt);
-        int proc_rows = data->height / (each_proc_sqrt);
+            for (int row = 0; row < tile_height; row++)
+            {
+                for (int column = 0; column < tile_width; column++)
+                {
+                    int bandIndex = 3 * (row * data->width + (start_column + column));
+                    int tileIndex = 3 * (row * tile_width + column);
 
-        int proc_start_columns = (proc % (each_proc_sqrt)) * proc_columns;
-        int proc_start_rows = (proc / (each_proc_sqrt)) * proc_rows;
+                    bands[band][bandIndex] = tile_pixels[tileIndex];
+                    bands[band][bandIndex + 1] = tile_pixels[tileIndex + 1];
+                    bands[band][bandIndex + 2] = tile_pixels[tileIndex + 2];
+                }
+            }
+            tiles_left[band]--;
+        }
 
-        
-        if (remaining_columns)
+        //Hand out the next tile before encoding, so the slave is not kept
+        //waiting while the master writes.
+        if (next_block < total_blocks)
         {
-            if (proc / (each_proc_sqrt) == (each_proc_sqrt) - 1)
-            { 
-                proc_columns += remaining_columns;
+            tileBounds(data, next_block, tile);
+            next_block++;
+
+            int band = tile[1] / data->dynamicBlockHeight;
+            if (bands[band] == NULL)
+            {
+                bands[band] = new float[band_size];
+                buffered_bands++;
+                peak_bands = std::max(peak_bands, buffered_bands);
             }
+
+            MPI_Send(tile, TILE_INFO_SIZE, MPI_INT, proc, TAG_TILE, MPI_COMM_WORLD);
         }
-      
-        if (remaining_rows)
+        else
         {
-            if ((proc % (each_proc_sqrt)) == (each_proc_sqrt) - 1)
-            { 
-                proc_rows += remaining_rows;
-            }
+            MPI_Send(tile, 0, MPI_INT, proc, TAG_TERMINATE, MPI_COMM_WORLD);
+            active_slaves--;
         }
 
-        end_column = proc_start_columns + proc_columns;
-        end_row = proc_start_rows + proc_rows;
-
-
-        int total_pixels = 3 * proc_columns * proc_rows;
-
-        float *proc_pixels = new float[total_pixels];
-
-        MPI_Recv(proc_pixels, total_pixels, MPI_FLOAT, proc, 0, MPI_COMM_WORLD, &status);
-
-        for (int i = proc_start_rows; i < end_row; i++)
+        double encodingStart = MPI_Wtime();
+        while (next_band < band_count && tiles_left[next_band] == 0)
         {
-            for (int j = proc_start_columns; j < end_column; j++)
-            { 
-                int row = i;
-                int column = j;
-
+            int rows = std::min(data->dynamicBlockHeight, data->height - next_band * data->dynamicBlockHeight);
 
-                int baseIndex = 3 * (row * data->width + column);
-                int procIndex = 3 * ((row - proc_start_rows) * proc_columns + (column - proc_start_columns));
+            writePngRows(stream, bands[next_band], rows);
 
-                pixels[baseIndex] = proc_pixels[procIndex];
-                pixels[baseIndex + 1] = proc_pixels[procIndex + 1];
-                pixels[baseIndex + 2] = proc_pixels[procIndex + 2];
-            }
+            delete[] bands[next_band];
+            bands[next_band] = NULL;
+            buffered_bands--;
+            next_band++;
         }
-
-        
+        encodingTime += MPI_Wtime() - encodingStart;
     }
 
-  
+    delete[] tile_pixels;
+    delete[] tiles_left;
+    delete[] bands;
+
+    double communicationTime;
+    double computationTime = collectSlaveStats(data, 2, NULL, &communicationTime);
+
     std::cout << "Total Computation Time: " << computationTime << " seconds" << std::endl;
     std::cout << "Total Communication Time: " << communicationTime << " seconds" << std::endl;
     double c2cRatio = communicationTime / computationTime;
     std::cout << "C-to-C Ratio: " << c2cRatio << std::endl;
+    std::cout << "Encoding Time: " << encodingTime << " seconds" << std::endl;
+    std::cout << "Peak Buffered Rows: " << peak_bands * data->dynamicBlockHeight << " of " << data->height << std::endl;
 }
 
-void masterCyclesV(ConfigData *data, float *pixels)
+void masterGuided(ConfigData *data, OutputImage *image)
 {
     MPI_Status status;
 
-    //Start the computation time timer.
-    double computationStart = MPI_Wtime();
+    int slaves = data->mpi_procs - 1;
+    int total_tiles = tileCount(data);
+    int next_tile = 0;
+    int tile_size = 3 * data->dynamicBlockWidth * data->dynamicBlockHeight;
 
-    for (int cycle = data->mpi_rank * data->cycleSize; cycle < data->width; cycle += data->cycleSize * data->mpi_procs)
+    //The first run handed out is the largest one any slave can hold.
+    //With the image on disk the runs are also kept small enough for the
+    //master's buffers.
+    int max_run = (total_tiles + slaves - 1) / slaves;
+    if (image->bufferValues > 0)
     {
-        for (int column = cycle; (column - cycle < data->cycleSize) && (column < data->width); column++)
-        {
-            for (int row = 0; row < data->height; row++)
-            {
-                //Calculate the index into the array.
-                int baseIndex = 3 * (row * data->width + column);
-                shadePixel(&(pixels[baseIndex]), row, column, data);
-            }
-        }
+        max_run = std::max(1, std::min(max_run, image->bufferValues / tile_size));
     }
+    float *run_pixels = new float[tile_size * max_run];
 
-    //Stop the comp. timer
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
+    //The master's guess of how many tiles every slave still has queued.
+    //It is only used to pick a victim once the master runs out of tiles.
+    int *outstanding = new int[data->mpi_procs];
+    for (int proc = 0; proc < data->mpi_procs; proc++)
+    {
+        outstanding[proc] = 0;
+    }
 
-    // Start the comm. timer
-    double communicationStart = MPI_Wtime();
+    //A slave that asks for work when nothing is left anywhere is parked
+    //until all of the others are parked as well; only then is every tile
+    //finished and no steal still in flight.
+    int parked = 0;
 
-    for (int i = 1; i < data->mpi_procs; i++)
-    { // Gather data from each processor
-        //Allocate buffer for receiving data
+    while (parked < slaves)
+    {
+        int run[RUN_INFO_SIZE];
 
-        int recv_cols = 0;
+        MPI_Recv(run, RUN_INFO_SIZE, MPI_INT, MPI_ANY_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &status);
+        int proc = status.MPI_SOURCE;
 
-        for (int cycle = i * data->cycleSize; cycle < data->width; cycle += data->cycleSize * data->mpi_procs)
+        outstanding[proc] = 0;
+        if (run[2] > 0)
         {
-            for (int column = cycle; (column - cycle < data->cycleSize) && (column < data->width); column++)
-            {
-                recv_cols++;
-            }
+            //The last steal found nothing, so the victim is drained.
+            outstanding[run[2]] = 0;
         }
 
-        int recv_buf_size = 3 * recv_cols * data->height;
-
-        float *recv_buf = new float[recv_buf_size];
-        double comm_recv_buf = 0.0;
+        if (run[1] > 0)
+        {
+            recvPixels(run_pixels, tile_size * run[1], proc, TAG_RESULT, &status);
 
-        MPI_Recv(recv_buf, recv_buf_size, MPI_FLOAT, i, 0, MPI_COMM_WORLD, &status); // Update Tag to be nicer
-        MPI_Recv(&comm_recv_buf, 1, MPI_DOUBLE, i, 0, MPI_COMM_WORLD, &status);      // Get computation time from each processor.
+            //Every tile was rendered into a slot of tile_size floats,
+            //whether or not it was cut short by the image edge.
+            for (int index = 0; index < run[1]; index++)
+            {
+                int tile[TILE_INFO_SIZE];
+                tileBounds(data, run[0] + index, tile);
 
-        if (comm_recv_buf > computationTime)
-        {                                    // Get largest computation time.
-            computationTime = comm_recv_buf; // The maximum comp time is the overall comp time.
+                putPixels(image, &(run_pixels[index * tile_size]), tile[0], tile[1], tile[2], tile[3], tile[2]);
+            }
         }
 
-        int bundle_column = 0; // The column we are currently looking at in the bundle
+        if (next_tile < total_tiles)
+        {
+            //Guided self-scheduling: hand out an equal share of what is
+            //left, so the runs shrink as the image fills in.
+            int remaining = total_tiles - next_tile;
+
+            run[0] = next_tile;
+            run[1] = std::min((remaining + slaves - 1) / slaves, max_run);
+            next_tile += run[1];
+            outstanding[proc] = run[1];
 
-        for (int cycle = i * data->cycleSize; cycle < data->width; cycle += data->cycleSize * data->mpi_procs)
+            MPI_Send(run, RUN_INFO_SIZE, MPI_INT, proc, TAG_TILE, MPI_COMM_WORLD);
+        }
+        else
         {
-            for (int column = cycle; (column - cycle < data->cycleSize) && (column < data->width); column++)
+            //Point the slave at whoever most likely has the most left.
+            int victim = 0;
+            for (int other = 1; other < data->mpi_procs; other++)
             {
-                for (int row = 0; row < data->height; row++)
+                if (other != proc && outstanding[other] > 1 && outstanding[other] > outstanding[victim])
                 {
-                    //Calculate the index into the array.
-                    int bundleIndex = 3 * (bundle_column * data->height + row);
-                    int baseIndex = 3 * (row * data->width + column);
-
-                    //Copy Pixel
-                    pixels[baseIndex] = recv_buf[bundleIndex];
-                    pixels[baseIndex + 1] = recv_buf[bundleIndex + 1];
-                    pixels[baseIndex + 2] = recv_buf[bundleIndex + 2];
+                    victim = other;
                 }
-                bundle_column++;
+            }
+
+            if (victim > 0)
+            {
+                //The victim gives away half of what it has left.
+                outstanding[proc] = outstanding[victim] / 2;
+                outstanding[victim] -= outstanding[proc];
+
+                MPI_Send(&victim, 1, MPI_INT, proc, TAG_VICTIM, MPI_COMM_WORLD);
+            }
+            else
+            {
+                parked++;
             }
         }
+    }
 
-        delete[] recv_buf;
+    for (int proc = 1; proc < data->mpi_procs; proc++)
+    {
+        MPI_Send(NULL, 0, MPI_INT, proc, TAG_TERMINATE, MPI_COMM_WORLD);
     }
 
-    //After receiving from all processes, the communication time will
-    //be obtained.
-    double communicationStop = MPI_Wtime();
-    double communicationTime = communicationStop - communicationStart;
+    delete[] run_pixels;
+    delete[] outstanding;
+
+    //The master spends the whole run handing out tiles, so the times that
+    //are reported are the largest ones measured on the slaves.
+    //{ computation time, communication time, tiles rendered, tiles stolen }
+    //from every slave
+    double *stats = new double[4 * data->mpi_procs];
+    double communicationTime;
+    double computationTime = collectSlaveStats(data, 4, stats, &communicationTime);
+
+    int totalSteals = 0;
+    double *rank_times = new double[data->mpi_procs];
+    int *rank_tiles = new int[data->mpi_procs];
+    for (int proc = 1; proc < data->mpi_procs; proc++)
+    {
+        rank_times[proc] = stats[4 * proc];
+        rank_tiles[proc] = (int)stats[4 * proc + 2];
+        totalSteals += (int)stats[4 * proc + 3];
+    }
+    delete[] stats;
 
-    //Print the times and the c-to-c ratio
-    //This section of printing, IN THIS ORDER, needs to be included in all of the
-    //functions that you write at the end of the function.
     std::cout << "Total Computation Time: " << computationTime << " seconds" << std::endl;
     std::cout << "Total Communication Time: " << communicationTime << " seconds" << std::endl;
     double c2cRatio = communicationTime / computationTime;
     std::cout << "C-to-C Ratio: " << c2cRatio << std::endl;
-}
\ No newline at end of file
+
+    printLoadBalance(rank_times, rank_tiles, 1, data->mpi_procs);
+    std::cout << "Tiles Stolen: " << totalSteals << std::endl;
+
+    delete[] rank_times;
+    delete[] rank_tiles;
+}
@@ -0,0 +1,243 @@
+//This file contains the parsing of the options that the MPI program
+//understands on top of the ones handled by the ray tracing library.
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include "options.h"
+
+static void printRunOptionsHelp()
+{
+    std::cout << "MPI Parameters:" << std::endl;
+    std::cout << "    -sched    The scheduler to use with dynamic partitioning" << std::endl;
+    std::cout << "              fixed - Hand out -bw x -bh tiles one at a time (default)" << std::endl;
+    std::cout << "              guided - Hand out shrinking runs of -bw x -bh tiles and" << std::endl;
+    std::cout << "                       let idle processes steal from busy ones" << std::endl;
+    std::cout << "    -t        The number of threads every process renders with (default 1)" << std::endl;
+    std::cout << "    -gather   How static horizontal strips are sent to the master" << std::endl;
+    std::cout << "              p2p - One send per process (default)" << std::endl;
+    std::cout << "              collective - MPI_Gatherv for the image and MPI_Reduce" << std::endl;
+    std::cout << "                           for the computation time" << std::endl;
+    std::cout << "    -stream   Write the image band by band as the tiles come in instead" << std::endl;
+    std::cout << "              of after rendering (dynamic partitioning, fixed scheduler)" << std::endl;
+    std::cout << "    -wire     How pixels are encoded when they are sent to the master" << std::endl;
+    std::cout << "              float - 32-bit floats, 12 bytes per pixel (default)" << std::endl;
+    std::cout << "              half - 16-bit floats, 6 bytes per pixel" << std::endl;
+    std::cout << "              byte - The 8-bit values of the saved image, 3 bytes per pixel" << std::endl;
+    std::cout << "    -allocs   Count the heap allocations made by all processes while rendering" << std::endl;
+    std::cout << "    -profile  Record the cost of every pixel and the busy, communication and" << std::endl;
+    std::cout << "              idle time of every process; writes a cost heatmap and a" << std::endl;
+    std::cout << "              per-rank CSV and JSON summary next to the image" << std::endl;
+    std::cout << "    -cost     Size static blocks by the cost of a pre-pass that shades one" << std::endl;
+    std::cout << "              pixel in every N x N cell, so that every process gets about" << std::endl;
+    std::cout << "              the same amount of work (static_blocks only)" << std::endl;
+    std::cout << "    -order    The order in which pixels and tiles are shaded" << std::endl;
+    std::cout << "              rows - Row by row (default)" << std::endl;
+    std::cout << "              morton - Along a Morton (Z-order) curve" << std::endl;
+    std::cout << "              hilbert - Along a Hilbert curve" << std::endl;
+    std::cout << "    -misses   Count the cache misses made by all processes while shading" << std::endl;
+    std::cout << "    -stage    Read the scene files on rank 0 only and broadcast them; every" << std::endl;
+    std::cout << "              node loads the scene from a copy in $TMPDIR (or /tmp)" << std::endl;
+    std::cout << "    -arena    Keep the objects of every scene in contiguous storage that is" << std::endl;
+    std::cout << "              given back in one piece when the program ends" << std::endl;
+    std::cout << "    -outofcore" << std::endl;
+    std::cout << "              Keep the image in a file next to the output while it is" << std::endl;
+    std::cout << "              rendered and encode it band by band at the end; the master's" << std::endl;
+    std::cout << "              pixel buffers are at most N MB each" << std::endl;
+    std::cout << std::endl;
+}
+
+bool parseRunOptions(int* argc, char** argv[], RunOptions* options)
+{
+    options->scheduler = SCHED_FIXED;
+    options->threads = 1;
+    options->gather = GATHER_P2P;
+    options->stream = false;
+    options->wire = WIRE_FLOAT;
+    options->allocations = false;
+    options->profile = false;
+    options->costSpacing = 0;
+    options->order = ORDER_ROWS;
+    options->cacheMisses = false;
+    options->stage = false;
+    options->arena = false;
+    options->outOfCore = 0;
+
+    char** args = *argv;
+    int kept = 1;
+
+    for (int i = 1; i < *argc; i++)
+    {
+        if (strcmp(args[i], "-sched") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                std::cerr << "ERROR: -sched requires a value." << std::endl;
+                return true;
+            }
+
+            i++;
+            if (strcmp(args[i], "fixed") == 0)
+            {
+                options->scheduler = SCHED_FIXED;
+            }
+            else if (strcmp(args[i], "guided") == 0)
+            {
+                options->scheduler = SCHED_GUIDED;
+            }
+            else
+            {
+                std::cerr << "ERROR: " << args[i] << " is not a valid scheduler." << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(args[i], "-t") == 0)
+        {
+            if (i + 1 >= *argc || atoi(args[i + 1]) < 1)
+            {
+                std::cerr << "ERROR: -t requires a thread count of at least 1." << std::endl;
+                return true;
+            }
+
+            i++;
+            options->threads = atoi(args[i]);
+        }
+        else if (strcmp(args[i], "-gather") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                std::cerr << "ERROR: -gather requires a value." << std::endl;
+                return true;
+            }
+
+            i++;
+            if (strcmp(args[i], "p2p") == 0)
+            {
+                options->gather = GATHER_P2P;
+            }
+            else if (strcmp(args[i], "collective") == 0)
+            {
+                options->gather = GATHER_COLLECTIVE;
+            }
+            else
+            {
+                std::cerr << "ERROR: " << args[i] << " is not a valid gather method." << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(args[i], "-wire") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                std::cerr << "ERROR: -wire requires a value." << std::endl;
+                return true;
+            }
+
+            i++;
+            if (strcmp(args[i], "float") == 0)
+            {
+                options->wire = WIRE_FLOAT;
+            }
+            else if (strcmp(args[i], "half") == 0)
+            {
+                options->wire = WIRE_HALF;
+            }
+            else if (strcmp(args[i], "byte") == 0)
+            {
+                options->wire = WIRE_BYTE;
+            }
+            else
+            {
+                std::cerr << "ERROR: " << args[i] << " is not a valid wire format." << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(args[i], "-stream") == 0)
+        {
+            options->stream = true;
+        }
+        else if (strcmp(args[i], "-allocs") == 0)
+        {
+            options->allocations = true;
+        }
+        else if (strcmp(args[i], "-profile") == 0)
+        {
+            options->profile = true;
+        }
+        else if (strcmp(args[i], "-cost") == 0)
+        {
+            if (i + 1 >= *argc || atoi(args[i + 1]) < 1)
+            {
+                std::cerr << "ERROR: -cost requires a sample spacing of at least 1." << std::endl;
+                return true;
+            }
+
+            i++;
+            options->costSpacing = atoi(args[i]);
+        }
+        else if (strcmp(args[i], "-order") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                std::cerr << "ERROR: -order requires a value." << std::endl;
+                return true;
+            }
+
+            i++;
+            if (strcmp(args[i], "rows") == 0)
+            {
+                options->order = ORDER_ROWS;
+            }
+            else if (strcmp(args[i], "morton") == 0)
+            {
+                options->order = ORDER_MORTON;
+            }
+            else if (strcmp(args[i], "hilbert") == 0)
+            {
+                options->order = ORDER_HILBERT;
+            }
+            else
+            {
+                std::cerr << "ERROR: " << args[i] << " is not a valid traversal order." << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(args[i], "-misses") == 0)
+        {
+            options->cacheMisses = true;
+        }
+        else if (strcmp(args[i], "-stage") == 0)
+        {
+            options->stage = true;
+        }
+        else if (strcmp(args[i], "-arena") == 0)
+        {
+            options->arena = true;
+        }
+        else if (strcmp(args[i], "-outofcore") == 0)
+        {
+            if (i + 1 >= *argc || atoi(args[i + 1]) < 1)
+            {
+                std::cerr << "ERROR: -outofcore requires a buffer size of at least 1 MB." << std::endl;
+                return true;
+            }
+
+            i++;
+            options->outOfCore = atoi(args[i]);
+        }
+        else
+        {
+            //The library prints its own usage after this one.
+            if (strcmp(args[i], "-help") == 0)
+            {
+                printRunOptionsHelp();
+            }
+
+            args[kept++] = args[i];
+        }
+    }
+
+    *argc = kept;
+    args[kept] = NULL;
+    return false;
+}
@@ -0,0 +1,174 @@
+//This file contains the image that the master collects the rendered
+//pixels in, either in memory or out of core.
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "outputimage.h"
+#include "pngstream.h"
+
+//This function returns the position of a pixel in the image file.
+static off_t pixelOffset(OutputImage* image, int column, int row)
+{
+    return (off_t)3 * sizeof(float) * ((off_t)row * image->width + column);
+}
+
+//This function returns the number of whole rows of the image that fit
+//into one of the master's buffers; at least one.
+static int bandRows(OutputImage* image)
+{
+    int rows = image->bufferValues / (3 * image->width);
+    return rows > 0 ? rows : 1;
+}
+
+int imageBufferValues(int megabytes)
+{
+    //A pixel is 3 floats; the values are kept below INT_MAX.
+    long long values = (long long)megabytes * 1024 * 1024 / sizeof(float);
+    if (values > 3 * (1 << 28))
+    {
+        values = 3 * (1 << 28);
+    }
+
+    return (int)(values - values % 3);
+}
+
+void openOutputImage(ConfigData* data, std::string filename, int megabytes, OutputImage* image)
+{
+    image->width = data->width;
+    image->height = data->height;
+    image->pixels = NULL;
+    image->file = -1;
+    image->bufferValues = 0;
+    image->failed = false;
+
+    if (megabytes > 0)
+    {
+        image->bufferValues = imageBufferValues(megabytes);
+
+        std::string path = filename + ".pixels";
+        image->file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (image->file >= 0)
+        {
+            unlink(path.c_str());
+
+            //Pixels that are never written read back as black.
+            if (ftruncate(image->file, pixelOffset(image, 0, image->height)) == 0)
+            {
+                return;
+            }
+
+            close(image->file);
+            image->file = -1;
+        }
+
+        std::cerr << "ERROR: " << path << " could not be created: " << strerror(errno) << std::endl;
+        std::cout << "The image will be kept in memory instead." << std::endl;
+    }
+
+    image->pixels = new float[3 * data->width * data->height];
+}
+
+void putPixels(OutputImage* image, float* pixels, int column, int row, int width, int height, int stride)
+{
+    for (int y = 0; y < height; y++)
+    {
+        float* source = &(pixels[3 * y * stride]);
+
+        if (image->pixels != NULL)
+        {
+            memcpy(&(image->pixels[3 * ((row + y) * image->width + column)]), source, 3 * width * sizeof(float));
+            continue;
+        }
+
+        //pwrite() may write less than asked for.
+        char* bytes = (char*)source;
+        size_t left = 3 * width * sizeof(float);
+        off_t offset = pixelOffset(image, column, row + y);
+        while (left > 0 && !image->failed)
+        {
+            ssize_t written = pwrite(image->file, bytes, left, offset);
+            if (written <= 0)
+            {
+                std::cerr << "ERROR: The image file could not be written: " << strerror(errno) << std::endl;
+                image->failed = true;
+                break;
+            }
+
+            bytes += written;
+            left -= written;
+            offset += written;
+        }
+    }
+}
+
+bool saveOutputImage(OutputImage* image, std::string filename, ConfigData* data)
+{
+    if (image->pixels != NULL)
+    {
+        savePixels(filename, image->pixels, data);
+        return false;
+    }
+
+    if (image->failed)
+    {
+        std::cerr << "ERROR: " << filename << " was not written, since the image file is incomplete." << std::endl;
+        return true;
+    }
+
+    PngStream stream;
+    if (openPngStream(filename, data, &stream))
+    {
+        return true;
+    }
+
+    //The image is read back and encoded one band of rows at a time.
+    int rows = bandRows(image);
+    float* band = new float[3 * rows * image->width];
+    bool failed = false;
+
+    for (int row = 0; row < image->height && !failed; row += rows)
+    {
+        int count = std::min(rows, image->height - row);
+
+        char* bytes = (char*)band;
+        size_t left = 3 * count * image->width * sizeof(float);
+        off_t offset = pixelOffset(image, 0, row);
+        while (left > 0)
+        {
+            ssize_t got = pread(image->file, bytes, left, offset);
+            if (got <= 0)
+            {
+                std::cerr << "ERROR: The image file could not be read: " << strerror(errno) << std::endl;
+                failed = true;
+                break;
+            }
+
+            bytes += got;
+            left -= got;
+            offset += got;
+        }
+
+        failed = failed || writePngRows(&stream, band, count);
+    }
+
+    delete[] band;
+
+    //The stream is closed even after a failure to free it.
+    return closePngStream(&stream) || failed;
+}
+
+void closeOutputImage(OutputImage* image)
+{
+    delete[] image->pixels;
+    image->pixels = NULL;
+
+    if (image->file >= 0)
+    {
+        close(image->file);
+        image->file = -1;
+    }
+}
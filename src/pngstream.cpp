@@ -0,0 +1,119 @@
+//This file contains the incremental PNG writer that is used when the
+//master streams the image to disk while it is being rendered.
+
+#include <iostream>
+#include "pngstream.h"
+#include "wire.h"
+
+bool openPngStream(std::string filename, ConfigData* data, PngStream* stream)
+{
+    stream->width = data->width;
+    stream->height = data->height;
+    stream->next_row = 0;
+    stream->png = NULL;
+    stream->info = NULL;
+    stream->row = NULL;
+
+    stream->file = fopen(filename.c_str(), "wb");
+    if (stream->file == NULL)
+    {
+        std::cerr << "ERROR: " << filename << " could not be opened for writing." << std::endl;
+        return true;
+    }
+
+    stream->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (stream->png != NULL)
+    {
+        stream->info = png_create_info_struct(stream->png);
+    }
+    if (stream->info == NULL)
+    {
+        std::cerr << "ERROR: The PNG write structures could not be created." << std::endl;
+        closePngStream(stream);
+        return true;
+    }
+
+    if (setjmp(png_jmpbuf(stream->png)))
+    {
+        std::cerr << "ERROR: The PNG header could not be written." << std::endl;
+        closePngStream(stream);
+        return true;
+    }
+
+    png_init_io(stream->png, stream->file);
+    png_set_IHDR(stream->png, stream->info, stream->width, stream->height, 8,
+                 PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(stream->png, stream->info);
+
+    stream->row = new png_byte[3 * stream->width];
+    return false;
+}
+
+bool writePngRows(PngStream* stream, float* pixels, int rows)
+{
+    if (setjmp(png_jmpbuf(stream->png)))
+    {
+        std::cerr << "ERROR: Row " << stream->next_row << " could not be written." << std::endl;
+        return true;
+    }
+
+    for (int row = 0; row < rows; row++)
+    {
+        float* color = &(pixels[3 * row * stream->width]);
+
+        for (int i = 0; i < 3 * stream->width; i++)
+        {
+            stream->row[i] = quantizeChannel(color[i]);
+        }
+
+        png_write_row(stream->png, stream->row);
+        stream->next_row++;
+    }
+
+    return false;
+}
+
+//This function writes the end of the file. It is kept apart from
+//closePngStream() so that no local variables are live across setjmp().
+static bool finishPng(PngStream* stream)
+{
+    if (setjmp(png_jmpbuf(stream->png)))
+    {
+        std::cerr << "ERROR: The PNG file could not be finished." << std::endl;
+        return true;
+    }
+
+    if (stream->next_row != stream->height)
+    {
+        std::cerr << "ERROR: Only " << stream->next_row << " of " << stream->height << " rows were written." << std::endl;
+        return true;
+    }
+
+    png_write_end(stream->png, NULL);
+    return false;
+}
+
+bool closePngStream(PngStream* stream)
+{
+    bool error = false;
+
+    if (stream->png != NULL && stream->row != NULL)
+    {
+        error = finishPng(stream);
+    }
+
+    if (stream->png != NULL)
+    {
+        png_destroy_write_struct(&(stream->png), &(stream->info));
+    }
+    if (stream->file != NULL)
+    {
+        fclose(stream->file);
+        stream->file = NULL;
+    }
+
+    delete[] stream->row;
+    stream->row = NULL;
+    return error;
+}
@@ -0,0 +1,395 @@
+//This file contains the load-balance profiler: the cost map, the
+//per-rank busy, communication and idle times and timelines, and the files
+//they are written to. The MPI calls are timed in profilempi.cpp.
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <mpi.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "profile.h"
+#include "pngstream.h"
+
+//The values every process reports to the master.
+typedef enum {
+    STAT_PIXELS = 0,
+    STAT_CYCLES = 1,
+    STAT_BUSY = 2,
+    STAT_COMMUNICATION = 3,
+    STAT_TOTAL = 4,
+    STAT_COUNT = 5
+} ProfileStat;
+
+static bool recording = false;
+
+//Width and height of the cells of the image that pixel costs are added
+//up in.
+#define PROFILE_CELL_SIZE 16
+
+//The cycles spent on every cell of the image while recording, and the
+//most that one of its pixels cost; a process only adds the pixels it
+//shades. They are copied to costs and peaks when the recording stops,
+//which on the master then hold the whole image.
+static std::atomic<unsigned long long>* cellCycles = NULL;
+static std::atomic<unsigned long long>* cellPeaks = NULL;
+static unsigned long long* costs = NULL;
+static unsigned long long* peaks = NULL;
+static int cellColumns = 0;
+static int cellRows = 0;
+
+//The number of pixels this process shaded
+static std::atomic<long long> shadedPixels(0);
+
+static double startTime = 0.0;
+static double busyTime = 0.0;
+static double communicationTime = 0.0;
+
+//The states of a process on its timeline; idle is every gap between the
+//intervals.
+typedef enum {
+    STATE_BUSY = 0,
+    STATE_COMMUNICATION = 1,
+    STATE_IDLE = 2
+} ProfileState;
+
+//Number of doubles used to describe an interval of a timeline:
+//{ state, start, stop }, in seconds since startProfile()
+#define INTERVAL_INFO_SIZE 3
+
+//The intervals of this process. On the master this holds the intervals
+//of every rank after stopProfile(), rank by rank.
+static std::vector<double> intervals;
+
+//The index of the first interval of every rank followed by the total;
+//only kept on the master.
+static std::vector<int> firstInterval;
+
+//The stats of every rank; only kept on the master.
+static double* rankStats = NULL;
+
+bool profiling()
+{
+    return recording;
+}
+
+void startProfile(ConfigData* data, bool enabled)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    cellColumns = (data->width + PROFILE_CELL_SIZE - 1) / PROFILE_CELL_SIZE;
+    cellRows = (data->height + PROFILE_CELL_SIZE - 1) / PROFILE_CELL_SIZE;
+    int cells = cellColumns * cellRows;
+    cellCycles = new std::atomic<unsigned long long>[cells];
+    cellPeaks = new std::atomic<unsigned long long>[cells];
+    for (int i = 0; i < cells; i++)
+    {
+        cellCycles[i] = 0;
+        cellPeaks[i] = 0;
+    }
+    shadedPixels = 0;
+
+    busyTime = 0.0;
+    communicationTime = 0.0;
+    intervals.clear();
+    recording = true;
+    startTime = MPI_Wtime();
+}
+
+unsigned long long readCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void recordPixelCost(int row, int column, unsigned long long cycles)
+{
+    //The pixels of a cell can be shaded by several threads.
+    int cell = (row / PROFILE_CELL_SIZE) * cellColumns + column / PROFILE_CELL_SIZE;
+    cellCycles[cell].fetch_add(cycles, std::memory_order_relaxed);
+    shadedPixels.fetch_add(1, std::memory_order_relaxed);
+
+    unsigned long long peak = cellPeaks[cell].load(std::memory_order_relaxed);
+    while (cycles > peak && !cellPeaks[cell].compare_exchange_weak(peak, cycles, std::memory_order_relaxed))
+    {
+    }
+}
+
+//This function adds an interval that ends now to the timeline. Intervals
+//of the same state are merged when the gap between them is shorter than
+//a microsecond, which is only the overhead of measuring them.
+static void addInterval(ProfileState state, double seconds)
+{
+    double stop = PMPI_Wtime() - startTime;
+    double start = std::max(0.0, stop - seconds);
+
+    size_t last = intervals.size();
+    if (last > 0 && intervals[last - INTERVAL_INFO_SIZE] == state && intervals[last - 1] > start - 1e-6)
+    {
+        intervals[last - 1] = stop;
+        return;
+    }
+
+    intervals.push_back(state);
+    intervals.push_back(start);
+    intervals.push_back(stop);
+}
+
+void addBusyTime(double seconds)
+{
+    if (recording)
+    {
+        busyTime += seconds;
+        addInterval(STATE_BUSY, seconds);
+    }
+}
+
+void addCommunicationTime(double seconds)
+{
+    if (recording)
+    {
+        communicationTime += seconds;
+        addInterval(STATE_COMMUNICATION, seconds);
+    }
+}
+
+void stopProfile(ConfigData* data)
+{
+    if (!recording)
+    {
+        return;
+    }
+
+    //Stop the clock before any of the collection below is counted.
+    double totalTime = MPI_Wtime() - startTime;
+    recording = false;
+
+    int cells = cellColumns * cellRows;
+    costs = new unsigned long long[cells];
+    peaks = new unsigned long long[cells];
+    double stats[STAT_COUNT] = { (double)shadedPixels, 0.0, busyTime, communicationTime, totalTime };
+    for (int i = 0; i < cells; i++)
+    {
+        costs[i] = cellCycles[i];
+        peaks[i] = cellPeaks[i];
+        stats[STAT_CYCLES] += costs[i];
+    }
+    delete[] cellCycles;
+    cellCycles = NULL;
+    delete[] cellPeaks;
+    cellPeaks = NULL;
+
+    //Adding the maps of all processes up merges them.
+    if (data->mpi_rank == 0)
+    {
+        rankStats = new double[STAT_COUNT * data->mpi_procs];
+        MPI_Reduce(MPI_IN_PLACE, costs, cells, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(MPI_IN_PLACE, peaks, cells, MPI_UNSIGNED_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    }
+    else
+    {
+        MPI_Reduce(costs, NULL, cells, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(peaks, NULL, cells, MPI_UNSIGNED_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+        delete[] costs;
+        costs = NULL;
+        delete[] peaks;
+        peaks = NULL;
+    }
+
+    MPI_Gather(stats, STAT_COUNT, MPI_DOUBLE, rankStats, STAT_COUNT, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    //The timelines are gathered behind each other.
+    int count = intervals.size();
+    int *counts = NULL;
+    int *displacements = NULL;
+    if (data->mpi_rank == 0)
+    {
+        counts = new int[data->mpi_procs];
+        displacements = new int[data->mpi_procs];
+    }
+
+    MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector<double> all;
+    if (data->mpi_rank == 0)
+    {
+        firstInterval.assign(1, 0);
+        for (int rank = 0; rank < data->mpi_procs; rank++)
+        {
+            displacements[rank] = INTERVAL_INFO_SIZE * firstInterval[rank];
+            firstInterval.push_back(firstInterval[rank] + counts[rank] / INTERVAL_INFO_SIZE);
+        }
+        all.resize(INTERVAL_INFO_SIZE * firstInterval[data->mpi_procs]);
+    }
+
+    MPI_Gatherv(intervals.data(), count, MPI_DOUBLE, all.data(), counts, displacements, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    intervals.swap(all);
+
+    delete[] counts;
+    delete[] displacements;
+}
+
+//This function maps a relative cost to a black, red, yellow, white
+//color ramp.
+static void heatColor(float cost, float* color)
+{
+    float scaled = 3.0f * cost;
+
+    color[0] = std::min(1.0f, std::max(0.0f, scaled));
+    color[1] = std::min(1.0f, std::max(0.0f, scaled - 1.0f));
+    color[2] = std::min(1.0f, std::max(0.0f, scaled - 2.0f));
+}
+
+static void writeHeatmap(ConfigData* data, std::string file)
+{
+    PngStream stream;
+    if (openPngStream(file, data, &stream))
+    {
+        return;
+    }
+
+    //Every cell is colored by what its pixels cost on average; the cells
+    //at the right and bottom edges can be smaller than the others. A few
+    //pixels (the first ones a thread shades, or ones interrupted by the
+    //OS) cost far more than the rest, so the most expensive pixel of a
+    //cell is left out.
+    int cells = cellColumns * cellRows;
+    std::vector<float> cellCosts(cells);
+    for (int cell = 0; cell < cells; cell++)
+    {
+        int columns = std::min(PROFILE_CELL_SIZE, data->width - (cell % cellColumns) * PROFILE_CELL_SIZE);
+        int rows = std::min(PROFILE_CELL_SIZE, data->height - (cell / cellColumns) * PROFILE_CELL_SIZE);
+        int pixels = columns * rows;
+        cellCosts[cell] = (pixels > 1) ? (float)(costs[cell] - peaks[cell]) / (pixels - 1) : (float)costs[cell];
+    }
+
+    //Cells can still be hit more than once, so the scale tops out at the
+    //99th percentile instead of at the most expensive cell.
+    std::vector<float> sorted(cellCosts);
+    std::nth_element(sorted.begin(), sorted.begin() + (cells - 1) * 99 / 100, sorted.end());
+    float maxCost = sorted[(cells - 1) * 99 / 100];
+
+    float* row = new float[3 * data->width];
+    for (int y = 0; y < data->height; y++)
+    {
+        for (int x = 0; x < data->width; x++)
+        {
+            float cellCost = cellCosts[(y / PROFILE_CELL_SIZE) * cellColumns + x / PROFILE_CELL_SIZE];
+            float cost = (maxCost > 0.0f) ? std::min(1.0f, cellCost / maxCost) : 0.0f;
+            heatColor(cost, &(row[3 * x]));
+        }
+        writePngRows(&stream, row, 1);
+    }
+    delete[] row;
+
+    closePngStream(&stream);
+}
+
+static void writeSummary(ConfigData* data, std::string csvFile, std::string jsonFile)
+{
+    std::ofstream csv(csvFile.c_str());
+    std::ofstream json(jsonFile.c_str());
+
+    csv << "rank,pixels,cycles,busy_seconds,communication_seconds,idle_seconds,total_seconds" << std::endl;
+    json << "{" << std::endl;
+    json << "  \"width\": " << data->width << "," << std::endl;
+    json << "  \"height\": " << data->height << "," << std::endl;
+    json << "  \"partitioning\": " << data->partitioningMode << "," << std::endl;
+    json << "  \"ranks\": [" << std::endl;
+
+    for (int rank = 0; rank < data->mpi_procs; rank++)
+    {
+        double* stats = &(rankStats[STAT_COUNT * rank]);
+        double idle = std::max(0.0, stats[STAT_TOTAL] - stats[STAT_BUSY] - stats[STAT_COMMUNICATION]);
+
+        csv << rank << "," << (long long)stats[STAT_PIXELS] << "," << stats[STAT_CYCLES] << ",";
+        csv << stats[STAT_BUSY] << "," << stats[STAT_COMMUNICATION] << "," << idle << ",";
+        csv << stats[STAT_TOTAL] << std::endl;
+
+        json << "    { \"rank\": " << rank;
+        json << ", \"pixels\": " << (long long)stats[STAT_PIXELS];
+        json << ", \"cycles\": " << stats[STAT_CYCLES];
+        json << ", \"busy_seconds\": " << stats[STAT_BUSY];
+        json << ", \"communication_seconds\": " << stats[STAT_COMMUNICATION];
+        json << ", \"idle_seconds\": " << idle;
+        json << ", \"total_seconds\": " << stats[STAT_TOTAL] << " }";
+        json << ((rank + 1 < data->mpi_procs) ? "," : "") << std::endl;
+    }
+
+    json << "  ]" << std::endl;
+    json << "}" << std::endl;
+}
+
+static void writeTimeline(ConfigData* data, std::string file)
+{
+    static const char* names[] = { "busy", "communication", "idle" };
+
+    std::ofstream csv(file.c_str());
+    csv << "rank,state,start_seconds,stop_seconds" << std::endl;
+
+    //Every rank's times count from its own start of the profile.
+    for (int rank = 0; rank < data->mpi_procs; rank++)
+    {
+        double last = 0.0;
+        for (int index = firstInterval[rank]; index < firstInterval[rank + 1]; index++)
+        {
+            double* interval = &(intervals[INTERVAL_INFO_SIZE * index]);
+            if (interval[1] > last)
+            {
+                csv << rank << "," << names[STATE_IDLE] << "," << last << "," << interval[1] << std::endl;
+            }
+
+            csv << rank << "," << names[(int)interval[0]] << "," << interval[1] << "," << interval[2] << std::endl;
+            last = interval[2];
+        }
+
+        double total = rankStats[STAT_COUNT * rank + STAT_TOTAL];
+        if (total > last)
+        {
+            csv << rank << "," << names[STATE_IDLE] << "," << last << "," << total << std::endl;
+        }
+    }
+}
+
+void writeProfile(ConfigData* data, std::string file)
+{
+    if (rankStats == NULL)
+    {
+        return;
+    }
+
+    //Name the files after the image, without its extension.
+    std::string base = file;
+    size_t extension = base.rfind(".png");
+    if (extension != std::string::npos && extension + 4 == base.size())
+    {
+        base = base.substr(0, extension);
+    }
+
+    writeHeatmap(data, base + "_cost.png");
+    writeSummary(data, base + "_profile.csv", base + "_profile.json");
+    writeTimeline(data, base + "_timeline.csv");
+
+    std::cout << "Profile written to: " << base << "_cost.png, ";
+    std::cout << base << "_profile.csv, " << base << "_profile.json, ";
+    std::cout << base << "_timeline.csv" << std::endl;
+
+    delete[] rankStats;
+    rankStats = NULL;
+    delete[] costs;
+    costs = NULL;
+    delete[] peaks;
+    peaks = NULL;
+    intervals.clear();
+}
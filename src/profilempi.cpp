@@ -0,0 +1,125 @@
+//This file contains the profiler's wrappers of the blocking MPI calls.
+//It is only linked with PROFILE_MPI=yes, the default, so that an external
+//PMPI tool such as mpiP can be linked instead.
+
+#include <mpi.h>
+#include "profile.h"
+
+//The blocking MPI calls are intercepted through the MPI profiling
+//interface, so that the time spent in them is counted as communication
+//without touching every partitioning scheme. Only the main thread makes
+//MPI calls. When the profiler is off, the calls go straight through.
+static int countCommunication(double start, int result)
+{
+    addCommunicationTime(PMPI_Wtime() - start);
+    return result;
+}
+
+int MPI_Send(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+{
+    if (!profiling())
+    {
+        return PMPI_Send(buf, count, datatype, dest, tag, comm);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Send(buf, count, datatype, dest, tag, comm));
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status* status)
+{
+    if (!profiling())
+    {
+        return PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Recv(buf, count, datatype, source, tag, comm, status));
+}
+
+int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status* status)
+{
+    if (!profiling())
+    {
+        return PMPI_Probe(source, tag, comm, status);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Probe(source, tag, comm, status));
+}
+
+int MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[])
+{
+    if (!profiling())
+    {
+        return PMPI_Waitall(count, requests, statuses);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Waitall(count, requests, statuses));
+}
+
+int MPI_Waitany(int count, MPI_Request requests[], int* index, MPI_Status* status)
+{
+    if (!profiling())
+    {
+        return PMPI_Waitany(count, requests, index, status);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Waitany(count, requests, index, status));
+}
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag,
+                 void* recvbuf, int recvcount, MPI_Datatype recvtype, int source, int recvtag,
+                 MPI_Comm comm, MPI_Status* status)
+{
+    if (!profiling())
+    {
+        return PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag,
+                             recvbuf, recvcount, recvtype, source, recvtag, comm, status);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag,
+                                                   recvbuf, recvcount, recvtype, source, recvtag,
+                                                   comm, status));
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                void* recvbuf, const int recvcounts[], const int displs[],
+                MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    if (!profiling())
+    {
+        return PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                                                  displs, recvtype, root, comm));
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype,
+               MPI_Op op, int root, MPI_Comm comm)
+{
+    if (!profiling())
+    {
+        return PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm));
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype,
+                  MPI_Op op, MPI_Comm comm)
+{
+    if (!profiling())
+    {
+        return PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+    }
+
+    double start = PMPI_Wtime();
+    return countCommunication(start, PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm));
+}
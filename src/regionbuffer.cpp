@@ -0,0 +1,170 @@
+//This file contains the buffers that hold a rank's share of the image
+//with the static partitioning schemes.
+
+#include <algorithm>
+#include "regionbuffer.h"
+#include "protocol.h"
+#include "renderpool.h"
+#include "shadetile.h"
+#include "traversal.h"
+#include "wire.h"
+
+void openRegionBuffer(Decomposition* decomposition, int rank, RegionBuffer* buffer)
+{
+    buffer->decomposition = decomposition;
+    buffer->rank = rank;
+    buffer->values = 3 * rankWork(decomposition, rank, traversalOrder(), buffer->work);
+    buffer->pixels = new float[buffer->values];
+}
+
+void renderRegion(RegionBuffer* buffer, ConfigData* data)
+{
+    parallelFor(buffer->work.size() / WORK_INFO_SIZE, data, [&](int index, ConfigData* scene)
+    {
+        int *piece = &(buffer->work[WORK_INFO_SIZE * index]);
+        int baseIndex = 3 * piece[4];
+
+        shadeTile(&(buffer->pixels[baseIndex]), piece[1], piece[0], piece[2], piece[3], piece[5], scene);
+    });
+}
+
+void placeRegion(RegionBuffer* buffer, OutputImage* image)
+{
+    std::vector<int> segments;
+    rowSegments(buffer->decomposition, buffer->rank, segments);
+
+    for (size_t index = 0; index < segments.size(); index += TILE_INFO_SIZE)
+    {
+        int *segment = &(segments[index]);
+        putPixels(image, &(buffer->pixels[3 * segment[3]]), segment[0], segment[1], segment[2], 1, segment[2]);
+    }
+}
+
+void renderRegionInPlace(Decomposition* decomposition, int rank, ConfigData* data, float* pixels)
+{
+    std::vector<int> work;
+    rankWork(decomposition, rank, traversalOrder(), work);
+
+    parallelFor(work.size() / WORK_INFO_SIZE, data, [&](int index, ConfigData* scene)
+    {
+        int *piece = &(work[WORK_INFO_SIZE * index]);
+        int baseIndex = 3 * (piece[1] * data->width + piece[0]);
+
+        shadeTile(&(pixels[baseIndex]), piece[1], piece[0], piece[2], piece[3], data->width, scene);
+    });
+}
+
+//This function renders a batch of rectangles and puts it into the image.
+static void renderBatch(Decomposition* batch, ConfigData* data, OutputImage* image)
+{
+    nextRank(batch);
+
+    RegionBuffer region;
+    openRegionBuffer(batch, 0, &region);
+    renderRegion(&region, data);
+    placeRegion(&region, image);
+    closeRegionBuffer(&region);
+}
+
+void renderRegionBands(Decomposition* decomposition, int rank, ConfigData* data, OutputImage* image)
+{
+    int budget = image->bufferValues / 3;
+
+    Decomposition batch;
+    startDecomposition(1, &batch);
+    int batchPixels = 0;
+
+    for (int index = decomposition->first[rank]; index < decomposition->first[rank + 1]; index++)
+    {
+        int *rect = &(decomposition->rects[TILE_INFO_SIZE * index]);
+
+        //Bands are kept to whole rows of traversal tiles where they can
+        //be, so that a curve order still covers square tiles.
+        int rows = std::max(1, budget / rect[2]);
+        if (rows >= TRAVERSAL_TILE_SIZE)
+        {
+            rows -= rows % TRAVERSAL_TILE_SIZE;
+        }
+
+        for (int row = rect[1]; row < rect[1] + rect[3]; row += rows)
+        {
+            int band = std::min(rows, rect[1] + rect[3] - row);
+
+            if (batchPixels > 0 && batchPixels + rect[2] * band > budget)
+            {
+                renderBatch(&batch, data, image);
+                startDecomposition(1, &batch);
+                batchPixels = 0;
+            }
+
+            addRect(&batch, rect[0], row, rect[2], band);
+            batchPixels += rect[2] * band;
+        }
+    }
+
+    if (batchPixels > 0)
+    {
+        renderBatch(&batch, data, image);
+    }
+}
+
+void sendRegion(RegionBuffer* buffer, int pieceValues)
+{
+    //The master posts a receive for every slave when the pixels come in
+    //one message, so a slave without pixels still sends an empty one.
+    if (pieceValues == 0)
+    {
+        sendPixels(buffer->pixels, buffer->values, 0, TAG_DATA);
+        return;
+    }
+
+    for (int start = 0; start < buffer->values; start += pieceValues)
+    {
+        sendPixels(&(buffer->pixels[start]), std::min(pieceValues, buffer->values - start), 0, TAG_DATA);
+    }
+}
+
+void receiveRegion(Decomposition* decomposition, int rank, OutputImage* image, float* scratch)
+{
+    std::vector<int> segments;
+    int values = 3 * rowSegments(decomposition, rank, segments);
+
+    //The rows of the rank are packed behind each other, so a piece may
+    //start or end in the middle of one.
+    size_t index = 0;
+    for (int start = 0; start < values; start += image->bufferValues)
+    {
+        int end = std::min(start + image->bufferValues, values);
+
+        MPI_Status status;
+        recvPixels(scratch, end - start, rank, TAG_DATA, &status);
+
+        while (index < segments.size())
+        {
+            int *segment = &(segments[index]);
+            if (3 * segment[3] >= end)
+            {
+                break;
+            }
+
+            int first = std::max(3 * segment[3], start);
+            int last = std::min(3 * (segment[3] + segment[2]), end);
+
+            int column = segment[0] + first / 3 - segment[3];
+            putPixels(image, &(scratch[first - start]), column, segment[1], (last - first) / 3, 1, 0);
+
+            if (last < 3 * (segment[3] + segment[2]))
+            {
+                break;
+            }
+            index += TILE_INFO_SIZE;
+        }
+    }
+}
+
+void closeRegionBuffer(RegionBuffer* buffer)
+{
+    delete[] buffer->pixels;
+    buffer->pixels = NULL;
+    buffer->values = 0;
+}
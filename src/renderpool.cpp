@@ -0,0 +1,178 @@
+//This file contains the thread pool that shades pixels in parallel
+//inside a single MPI process.
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include "renderpool.h"
+#include "profile.h"
+#include "cachemisses.h"
+#include "allocations.h"
+
+static std::vector<std::thread> workers;
+static std::vector<ConfigData*> scenes;
+
+static std::mutex poolMutex;
+static std::condition_variable poolWake;
+static std::condition_variable poolDone;
+
+//The job that is currently being run by the pool.
+static const std::function<void(int, ConfigData*)>* jobBody = NULL;
+static int jobCount = 0;
+static std::atomic<int> jobNext(0);
+
+//Bumped for every job so that the workers can tell a new one apart
+//from a spurious wake up.
+static int jobGeneration = 0;
+static int busyWorkers = 0;
+static bool stopping = false;
+
+static void runJob(ConfigData* scene)
+{
+    startThreadCount();
+
+    int index;
+    while ((index = jobNext++) < jobCount)
+    {
+        (*jobBody)(index, scene);
+    }
+
+    stopThreadCount();
+}
+
+static void workerMain(ConfigData* scene)
+{
+    int seenGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            poolWake.wait(lock, [&] { return stopping || jobGeneration != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = jobGeneration;
+        }
+
+        runJob(scene);
+
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            busyWorkers--;
+            if (busyWorkers == 0)
+            {
+                poolDone.notify_one();
+            }
+        }
+    }
+}
+
+bool startRenderThreads(int threads, int argc, char* argv[], ConfigData* data)
+{
+    for (int i = 1; i < threads; i++)
+    {
+        //initialize() is handed its own copy of the argument list so
+        //that every scene is parsed from exactly the same parameters.
+        std::vector<char*> args(argv, argv + argc);
+        args.push_back(NULL);
+        int scene_argc = argc;
+        char** scene_argv = &(args[0]);
+
+        //Only the scene itself goes into the arena.
+        ConfigData* scene = new ConfigData;
+        useSceneArena(true);
+        bool failed = initialize(&scene_argc, &scene_argv, scene);
+        useSceneArena(false);
+
+        if (failed)
+        {
+            std::cerr << "Could not load the scene for render thread " << i << "." << std::endl;
+            delete scene;
+            stopRenderThreads();
+            return true;
+        }
+        scene->mpi_rank = data->mpi_rank;
+        scene->mpi_procs = data->mpi_procs;
+
+        scenes.push_back(scene);
+    }
+
+    for (size_t i = 0; i < scenes.size(); i++)
+    {
+        workers.push_back(std::thread(workerMain, scenes[i]));
+    }
+
+    return false;
+}
+
+static void runParallel(int count, ConfigData* data, const std::function<void(int, ConfigData*)>& body)
+{
+    //Nothing to share, so skip the hand off to the workers.
+    if (workers.empty() || count <= 1)
+    {
+        startThreadCount();
+        for (int index = 0; index < count; index++)
+        {
+            body(index, data);
+        }
+        stopThreadCount();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        jobBody = &body;
+        jobCount = count;
+        jobNext = 0;
+        busyWorkers = workers.size();
+        jobGeneration++;
+    }
+    poolWake.notify_all();
+
+    //The calling thread takes part as well.
+    runJob(data);
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    poolDone.wait(lock, [] { return busyWorkers == 0; });
+    jobBody = NULL;
+}
+
+void parallelFor(int count, ConfigData* data, const std::function<void(int, ConfigData*)>& body)
+{
+    //All of the shading goes through here, so this is where the
+    //profiler's busy time is measured.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    runParallel(count, data, body);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    addBusyTime(elapsed.count());
+}
+
+void stopRenderThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    poolWake.notify_all();
+
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+
+    for (size_t i = 0; i < scenes.size(); i++)
+    {
+        shutdown(scenes[i]);
+        delete scenes[i];
+    }
+    scenes.clear();
+}
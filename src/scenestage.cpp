@@ -0,0 +1,313 @@
+//This file contains the staging of the scene files through MPI.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "scenestage.h"
+
+//The largest piece of the scene that is broadcast at once; MPI counts
+//are ints.
+#define STAGE_CHUNK (1 << 30)
+
+//This function tells whether a path stays inside the working directory.
+static bool isLocalPath(const std::string& path)
+{
+    return !path.empty() && path[0] != '/' && path.find("..") == std::string::npos;
+}
+
+//This function returns the size of a file, or -1 if it is not a
+//regular file.
+static long long fileSize(const std::string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        return -1;
+    }
+    return info.st_size;
+}
+
+//This function adds a file to the list unless it is already on it or
+//cannot be read from the working directory.
+static bool addPath(const std::string& path, std::vector<std::string>& files)
+{
+    if (!isLocalPath(path) || fileSize(path) < 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (files[i] == path)
+        {
+            return false;
+        }
+    }
+
+    files.push_back(path);
+    return true;
+}
+
+//This function lists the configuration file and the files it refers to:
+//the <Path> of every model, and the mtllib of every OBJ file, which the
+//library looks up next to the OBJ file. Only the configuration and the
+//OBJ files are read, the latter a line at a time.
+static void sceneFiles(const std::string& config, std::vector<std::string>& files)
+{
+    if (!addPath(config, files))
+    {
+        return;
+    }
+
+    std::ifstream config_file(config.c_str());
+    std::stringstream buffer;
+    buffer << config_file.rdbuf();
+    std::string text = buffer.str();
+
+    size_t start = 0;
+    while ((start = text.find("<Path>", start)) != std::string::npos)
+    {
+        start += strlen("<Path>");
+        size_t stop = text.find("</Path>", start);
+        if (stop == std::string::npos)
+        {
+            break;
+        }
+
+        std::stringstream trimmed(text.substr(start, stop - start));
+        std::string path;
+        trimmed >> path;
+
+        size_t dot = path.rfind('.');
+        if (!addPath(path, files) || dot == std::string::npos || path.substr(dot) != ".obj")
+        {
+            continue;
+        }
+
+        std::string folder = (path.rfind('/') == std::string::npos) ? "" : path.substr(0, path.rfind('/') + 1);
+        std::ifstream model(path.c_str());
+        std::string line;
+        while (std::getline(model, line))
+        {
+            std::stringstream words(line);
+            std::string keyword, name;
+            words >> keyword;
+            if (keyword != "mtllib")
+            {
+                continue;
+            }
+
+            while (words >> name)
+            {
+                addPath(folder + name, files);
+            }
+        }
+    }
+}
+
+//This function collects the files of the scene into a blob: for every
+//file the length of its path, the path, the length of its contents and
+//the contents. The files are read straight into the blob.
+static int collectScene(const std::string& config, std::string& blob)
+{
+    std::vector<std::string> files;
+    sceneFiles(config, files);
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        long long path_size = files[i].size();
+        long long contents_size = fileSize(files[i]);
+        blob.append((const char*)&path_size, sizeof(path_size));
+        blob.append(files[i]);
+        blob.append((const char*)&contents_size, sizeof(contents_size));
+
+        size_t position = blob.size();
+        blob.resize(position + contents_size);
+
+        std::ifstream file(files[i].c_str(), std::ios::binary);
+        if (!file.read(&(blob[position]), contents_size))
+        {
+            blob.clear();
+            return 0;
+        }
+    }
+
+    return files.size();
+}
+
+//This function writes the files of the blob below a directory, making
+//the directories they need on the way.
+static bool writeScene(const std::string& directory, const std::string& blob, std::vector<std::string>& paths)
+{
+    size_t position = 0;
+    while (position < blob.size())
+    {
+        long long path_size, contents_size;
+        memcpy(&path_size, &(blob[position]), sizeof(path_size));
+        position += sizeof(path_size);
+        std::string path = blob.substr(position, path_size);
+        position += path_size;
+        memcpy(&contents_size, &(blob[position]), sizeof(contents_size));
+        position += sizeof(contents_size);
+
+        for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1))
+        {
+            std::string folder = directory + "/" + path.substr(0, slash);
+            if (mkdir(folder.c_str(), 0700) == 0)
+            {
+                paths.push_back(folder);
+            }
+        }
+
+        std::string staged = directory + "/" + path;
+        std::ofstream file(staged.c_str(), std::ios::binary);
+        file.write(&(blob[position]), contents_size);
+        position += contents_size;
+        if (!file)
+        {
+            return false;
+        }
+        paths.push_back(staged);
+    }
+
+    return true;
+}
+
+//This function finds the configuration file given with -c.
+static const char* configPath(int argc, char* argv[])
+{
+    const char* config = "";
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0)
+        {
+            config = argv[i + 1];
+        }
+    }
+    return config;
+}
+
+long long sceneSize(int argc, char* argv[])
+{
+    std::vector<std::string> files;
+    sceneFiles(configPath(argc, argv), files);
+
+    long long bytes = 0;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        bytes += fileSize(files[i]);
+    }
+
+    return bytes;
+}
+
+void stageScene(int argc, char* argv[], SceneStage* stage)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    stage->active = false;
+    stage->node = MPI_COMM_NULL;
+
+    //Rank 0 reads the scene and tells everyone how big it is.
+    std::string blob;
+    long long blob_size = 0;
+    int files = 0;
+    if (rank == 0)
+    {
+        files = collectScene(configPath(argc, argv), blob);
+        blob_size = blob.size();
+    }
+
+    MPI_Bcast(&blob_size, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (blob_size == 0)
+    {
+        if (rank == 0)
+        {
+            std::cout << "The scene could not be staged; every process reads it." << std::endl;
+        }
+        return;
+    }
+
+    blob.resize(blob_size);
+    for (long long offset = 0; offset < blob_size; offset += STAGE_CHUNK)
+    {
+        int count = (blob_size - offset < STAGE_CHUNK) ? blob_size - offset : STAGE_CHUNK;
+        MPI_Bcast(&(blob[offset]), count, MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+
+    //One process per node writes the copy and tells the others where it is.
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &(stage->node));
+
+    int node_rank;
+    MPI_Comm_rank(stage->node, &node_rank);
+
+    char directory[4096] = "";
+    if (node_rank == 0)
+    {
+        const char* temp = getenv("TMPDIR");
+        std::string pattern = std::string((temp != NULL) ? temp : "/tmp") + "/raytrace_scene_XXXXXX";
+
+        strncpy(directory, pattern.c_str(), sizeof(directory) - 1);
+        if (mkdtemp(directory) == NULL || !writeScene(directory, blob, stage->paths))
+        {
+            std::cerr << "Could not stage the scene in " << directory << "." << std::endl;
+            for (size_t i = stage->paths.size(); i > 0; i--)
+            {
+                remove(stage->paths[i - 1].c_str());
+            }
+            stage->paths.clear();
+            rmdir(directory);
+            directory[0] = '\0';
+        }
+    }
+    MPI_Bcast(directory, sizeof(directory), MPI_CHAR, 0, stage->node);
+    stage->directory = directory;
+
+    if (rank == 0)
+    {
+        std::cout << "Staged " << files << " scene files (" << blob_size << " bytes) for all processes." << std::endl;
+    }
+
+    //Rank 0 already read the scene from where it is.
+    char home[4096];
+    if (rank != 0 && !stage->directory.empty() && getcwd(home, sizeof(home)) != NULL)
+    {
+        stage->home = home;
+        stage->active = (chdir(directory) == 0);
+    }
+}
+
+void finishStaging(SceneStage* stage)
+{
+    if (stage->active && chdir(stage->home.c_str()) != 0)
+    {
+        std::cerr << "Could not return to " << stage->home << " after loading the scene." << std::endl;
+    }
+    stage->active = false;
+
+    if (stage->node == MPI_COMM_NULL)
+    {
+        return;
+    }
+
+    //Wait for the whole node to load the scene before removing it.
+    MPI_Barrier(stage->node);
+
+    //Only the process that wrote the copy knows its files.
+    for (size_t i = stage->paths.size(); i > 0; i--)
+    {
+        remove(stage->paths[i - 1].c_str());
+    }
+    if (!stage->paths.empty())
+    {
+        rmdir(stage->directory.c_str());
+    }
+    stage->paths.clear();
+
+    MPI_Comm_free(&(stage->node));
+}
@@ -0,0 +1,71 @@
+//This file contains the tile shading entry point used by the
+//partitioning code.
+
+#include <iostream>
+#include <vector>
+#include "shadetile.h"
+#include "profile.h"
+#include "traversal.h"
+
+//This function shades a single pixel of a tile, timing it when the
+//profiler is recording.
+static inline void shadeTilePixel(float* color, int row, int column, bool measure, ConfigData* data)
+{
+    if (measure)
+    {
+        unsigned long long start = readCycleCounter();
+        shadePixel(color, row, column, data);
+        recordPixelCost(row, column, readCycleCounter() - start);
+    }
+    else
+    {
+        shadePixel(color, row, column, data);
+    }
+}
+
+void shadeTile(float* out, int row0, int col0, int w, int h, int stride, ConfigData* data)
+{
+    if (row0 < 0 || col0 < 0 || row0 + h > data->height || col0 + w > data->width)
+    {
+        std::cout << "ERROR shading tile: The tile at row " << row0 << ", column " << col0;
+        std::cout << " (" << w << "x" << h << ") is not inside the image." << std::endl;
+        return;
+    }
+
+    bool measure = profiling();
+
+    //A single row or column has nothing to reorder.
+    if (traversalOrder() != ORDER_ROWS && w > 1 && h > 1)
+    {
+        //Most tiles have the same size, so the order is only worked out
+        //again when it changes.
+        thread_local std::vector<int> cells;
+        thread_local int cells_width = 0, cells_height = 0;
+        thread_local TraversalOrder cells_order = ORDER_ROWS;
+        if (cells_width != w || cells_height != h || cells_order != traversalOrder())
+        {
+            curveOrder(w, h, traversalOrder(), cells);
+            cells_width = w;
+            cells_height = h;
+            cells_order = traversalOrder();
+        }
+
+        for (size_t index = 0; index < cells.size(); index++)
+        {
+            int r = cells[index] / w;
+            int c = cells[index] % w;
+            shadeTilePixel(&(out[3 * (r * stride + c)]), row0 + r, col0 + c, measure, data);
+        }
+        return;
+    }
+
+    for (int r = 0; r < h; r++)
+    {
+        float* color = &(out[3 * r * stride]);
+
+        for (int c = 0; c < w; c++)
+        {
+            shadeTilePixel(&(color[3 * c]), row0 + r, col0 + c, measure, data);
+        }
+    }
+}
@@ -4,247 +4,355 @@
 #include <mpi.h>
 #include "RayTrace.h"
 #include "slave.h"
+#include "protocol.h"
+#include "tiles.h"
+#include "renderpool.h"
+#include "shadetile.h"
+#include "wire.h"
+#include "allocations.h"
+#include "profile.h"
+#include "decomposition.h"
+#include "traversal.h"
+#include "cachemisses.h"
+#include "regionbuffer.h"
 #include<math.h>
+#include <algorithm>
+#include <vector>
 
-void slaveMain(ConfigData* data)
+void slaveMain(ConfigData* data, RunOptions* options)
 {
     //Depending on the partitioning scheme, different things will happen.
     //You should have a different function for each of the required 
     //schemes that returns some values that you need to handle.
 
-    
+    setWireFormat(options->wire, data->mpi_procs);
+    setTraversalOrder(options->order);
+    orderTiles(data, options->order);
+    countAllocations(options->allocations);
+    countCacheMisses(options->cacheMisses);
+    startProfile(data, options->profile);
+
     switch (data->partitioningMode)
     {
         case PART_MODE_NONE:
             //The slave will do nothing since this means sequential operation.
             break;
         case PART_MODE_STATIC_STRIPS_HORIZONTAL:
-            slaveMPIHorizontal(data);
-            break;
         case PART_MODE_STATIC_STRIPS_VERTICAL:
-            slaveMPIVertical(data);
-            break;
         case PART_MODE_STATIC_BLOCKS:
-            slaveMPIBlock(data);
-            break;
+        case PART_MODE_STATIC_CYCLES_HORIZONTAL:
         case PART_MODE_STATIC_CYCLES_VERTICAL:
-            slaveMPICylicVertical(data);
+            //An image on disk is collected in pieces, which the collective
+            //gather cannot do.
+            if (data->partitioningMode == PART_MODE_STATIC_STRIPS_HORIZONTAL && options->gather == GATHER_COLLECTIVE && options->outOfCore == 0)
+            {
+                slaveMPIHorizontalCollective(data);
+            }
+            else
+            {
+                slaveStatic(data, options->costSpacing, options->outOfCore > 0 ? imageBufferValues(options->outOfCore) : 0);
+            }
+            break;
+        case PART_MODE_DYNAMIC:
+            if (options->scheduler == SCHED_GUIDED)
+            {
+                slaveGuided(data);
+            }
+            else
+            {
+                slaveDynamic(data);
+            }
             break;
         default:
             std::cout << "This mode (" << data->partitioningMode;
             std::cout << ") is not currently implemented." << std::endl;
             break;
     }
-}
 
+    stopProfile(data);
 
-void slaveMPIHorizontal(ConfigData *data)
-{
-
-    double computationStart = MPI_Wtime();
+    //The master adds up the allocations of all processes.
+    if (options->allocations)
+    {
+        countAllocations(false);
 
-    int rows_per_process = (data->height) / (data->mpi_procs);
-    int remaining = data->height % data->mpi_procs;
+        long long processAllocations = allocationCount();
+        MPI_Reduce(&processAllocations, NULL, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    }
 
-    if (remaining > data->mpi_rank)
+    if (options->cacheMisses)
     {
-        rows_per_process++;
+        countCacheMisses(false);
+
+        long long processCounts[3] = { cacheMissCount(), cacheReferenceCount(), cacheMissesAvailable() ? 0 : 1 };
+        MPI_Reduce(processCounts, NULL, 3, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
     }
+}
 
-    int start_row = data->mpi_rank * rows_per_process - 1;
 
-    if (remaining)
-    {
-        if (data->mpi_rank - (remaining) < 0)
-        {
-            start_row++;
-        }
-        else
-        {
-            start_row = start_row + remaining + 1;
-        }
-    }
+void slaveStatic(ConfigData *data, int costSpacing, int pieceValues)
+{
+    double computationStart = MPI_Wtime();
 
-    int total_pixels = 3 * rows_per_process * data->width;
-    float *pixels = new float[total_pixels];
-    int end_row = start_row + rows_per_process;
-    int next = 0;
-    for (int i = start_row; i < end_row; i++)
-    {
-        for (int j = 0; j < data->width; j++)
-        {
-            int row = i;
-            int column = j;
-            int baseIndex = 3 * (next * data->width + column);
+    Decomposition decomposition;
+    staticDecomposition(data, costSpacing, &decomposition);
 
-            shadePixel(&(pixels[baseIndex]), row, column, data);
-        }
-        next++;
-    }
+    //Only the slave's own share is allocated, in the order the master
+    //expects it.
+    RegionBuffer region;
+    openRegionBuffer(&decomposition, data->mpi_rank, &region);
+    renderRegion(&region, data);
 
     double computationStop = MPI_Wtime();
     double computationTime = computationStop - computationStart;
 
-    MPI_Send(pixels, total_pixels, MPI_FLOAT, 0, 0, MPI_COMM_WORLD);
+    sendRegion(&region, pieceValues);
     MPI_Send(&computationTime, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
-}
 
-void slaveMPIVertical(ConfigData *data) {
+    closeRegionBuffer(&region);
+}
 
+void slaveMPIHorizontalCollective(ConfigData *data)
+{
     double computationStart = MPI_Wtime();
 
-    int columns_per_process = (data->width) / (data->mpi_procs);
-    int remaining = data->width % data->mpi_procs;
+    Decomposition decomposition;
+    staticDecomposition(data, 0, &decomposition);
 
-    if (remaining > data->mpi_rank)
-    {              
-        columns_per_process++; 
-    }
+    RegionBuffer region;
+    openRegionBuffer(&decomposition, data->mpi_rank, &region);
+    renderRegion(&region, data);
 
-    int start_column = data->mpi_rank * columns_per_process - 1; 
+    int total_pixels = region.values;
+    float *pixels = region.pixels;
 
-    if (remaining)
-    { 
-        if (data->mpi_rank - (remaining) < 0)
-        { 
-            start_column++;
-        }
-        else
-        { 
-            start_column =start_column  + remaining + 1;
-        }
-    }
-
-    int total_pixels = 3 *data->height *columns_per_process;
-    float *pixels = new float[total_pixels];
-    int end_column = start_column + columns_per_process;
-    int next = 0;
-    for (int i = 0; i < data->height; i++)
-    {
-        next = 0;
-        for (int j = start_column; j < end_column; j++)
-        { 
-            int row = i;
-            int column = j;
-            int baseIndex = 3 * (row * columns_per_process + next);
-
-            shadePixel(&(pixels[baseIndex]), row, column, data); 
-            next++;
-        }
-        
-    }
-    
     double computationStop = MPI_Wtime();
     double computationTime = computationStop - computationStart;
 
-    MPI_Send(pixels, total_pixels, MPI_FLOAT, 0, 0, MPI_COMM_WORLD);
-    MPI_Send(&computationTime, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+    //The receive arguments are only used on the master.
+    if (wireFormat() == WIRE_FLOAT)
+    {
+        MPI_Gatherv(pixels, total_pixels, MPI_FLOAT, NULL, NULL, NULL, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    }
+    else
+    {
+        unsigned char *buffer = new unsigned char[wireBytes(total_pixels)];
+        encodePixels(pixels, total_pixels, buffer);
+        MPI_Gatherv(buffer, wireBytes(total_pixels), MPI_BYTE, NULL, NULL, NULL, MPI_BYTE, 0, MPI_COMM_WORLD);
+        delete[] buffer;
+    }
+    MPI_Reduce(&computationTime, NULL, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 
-    
+    closeRegionBuffer(&region);
 }
 
-
-void slaveMPIBlock(ConfigData *data)
+//This function renders a tile handed out by the master, packed row by
+//row. The tile is cut into pieces like a static share, so a curve order
+//also applies to the pixels inside it.
+//
+//Inputs:
+//    pixels - receives the colors of the tile
+//    tile - the bounds of the tile, TILE_INFO_SIZE integers
+//    data - the ConfigData that holds the scene information.
+static void renderTile(float* pixels, int* tile, ConfigData* data)
 {
-    double computationStart = MPI_Wtime();
+    Decomposition decomposition;
+    startDecomposition(1, &decomposition);
+    addRect(&decomposition, tile[0], tile[1], tile[2], tile[3]);
+    nextRank(&decomposition);
+
+    std::vector<int> work;
+    rankWork(&decomposition, 0, traversalOrder(), work);
 
+    parallelFor(work.size() / WORK_INFO_SIZE, data, [&](int index, ConfigData* scene)
+    {
+        int *piece = &(work[WORK_INFO_SIZE * index]);
+        shadeTile(&(pixels[3 * piece[4]]), piece[1], piece[0], piece[2], piece[3], piece[5], scene);
+    });
+}
+
+void slaveDynamic(ConfigData *data)
+{
     MPI_Status status;
-    int each_proc_sqrt = (int)sqrt(data->mpi_procs);
-    int columns_per_process = data->width / each_proc_sqrt;
-    int rows_per_process = data->height / each_proc_sqrt;
 
-    int remaining_columns = data->width % each_proc_sqrt;
-    int remaining_rows = data->height % each_proc_sqrt;
+    double computationTime = 0.0;
+    double communicationTime = 0.0;
 
-    int start_column = (data->mpi_rank / (each_proc_sqrt)) * columns_per_process;
-    int start_row = (data->mpi_rank % (each_proc_sqrt)) * rows_per_process;
+    float *pixels = new float[3 * data->dynamicBlockWidth * data->dynamicBlockHeight];
+    int tile[TILE_INFO_SIZE] = { 0, 0, 0, 0 };
 
-    if (remaining_columns)
-    {
-        if ((data->mpi_rank % (each_proc_sqrt)) == (each_proc_sqrt)-1)
-        {
-            columns_per_process += remaining_columns;
-        }
-    }
+    //Ask the master for the first tile.
+    double communicationStart = MPI_Wtime();
+    MPI_Send(tile, TILE_INFO_SIZE, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+    MPI_Recv(tile, TILE_INFO_SIZE, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+    communicationTime += MPI_Wtime() - communicationStart;
 
-    if (remaining_rows)
+    while (status.MPI_TAG == TAG_TILE)
     {
-        if (data->mpi_rank / (each_proc_sqrt) == (each_proc_sqrt)-1)
-        {
-            rows_per_process += remaining_rows;
-        }
-    }
+        int tile_width = tile[2];
+        int tile_height = tile[3];
 
-    int end_column = start_column + columns_per_process;
-    int end_row = start_row + rows_per_process;
+        double computationStart = MPI_Wtime();
 
-    int totat_pixels = 3 * columns_per_process * rows_per_process;
-    float *pixels = new float[totat_pixels];
-    for (int i = start_row; i < end_row; i++)
-    {
-        for (int j = start_column; j < end_column; j++)
-        {
-            int row = i;
-            int column = j;
-            
-            int base_row = row - start_row;
-            int base_column = column - start_column;
+        renderTile(pixels, tile, data);
 
-            int baseIndex = 3 * (base_row * columns_per_process + base_column);
+        computationTime += MPI_Wtime() - computationStart;
 
-            shadePixel(&(pixels[baseIndex]), row, column, data);
-        }
+        //Hand back the finished tile; the master answers with the next
+        //tile or tells us that there is nothing left to do.
+        communicationStart = MPI_Wtime();
+        MPI_Send(tile, TILE_INFO_SIZE, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+        sendPixels(pixels, 3 * tile_width * tile_height, 0, TAG_RESULT);
+        MPI_Recv(tile, TILE_INFO_SIZE, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+        communicationTime += MPI_Wtime() - communicationStart;
     }
 
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
-
-    MPI_Send(pixels, totat_pixels, MPI_FLOAT, 0, 0, MPI_COMM_WORLD);
-    MPI_Send(&computationTime, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+    delete[] pixels;
 
+    double times[2] = { computationTime, communicationTime };
+    MPI_Send(times, 2, MPI_DOUBLE, 0, TAG_DATA, MPI_COMM_WORLD);
 }
 
-void slaveMPICylicVertical(ConfigData *data)
+//This function answers a steal request from another slave by giving
+//away the back half of the tiles that have not been started yet.
+//
+//Inputs:
+//    thief - the rank that asked for work
+//    next_tile - the next tile this slave would render
+//    end_tile - one past the last tile of this slave's run; lowered by
+//        the number of tiles given away
+static void answerStealRequest(int thief, int next_tile, int *end_tile)
 {
+    MPI_Status status;
+    MPI_Recv(NULL, 0, MPI_INT, thief, TAG_STEAL_REQUEST, MPI_COMM_WORLD, &status);
 
-    double computationStart = MPI_Wtime();
+    int given = (*end_tile - next_tile) / 2;
+    *end_tile -= given;
 
-    int columns_per_process = 0;
+    int run[RUN_INFO_SIZE] = { *end_tile, given, -1 };
+    MPI_Send(run, RUN_INFO_SIZE, MPI_INT, thief, TAG_STEAL_REPLY, MPI_COMM_WORLD);
+}
 
-    int start_column = data->mpi_rank * data->cycleSize;
-    int counter = data->cycleSize * data->mpi_procs;
-    
-    for (int cycle = start_column; cycle < data->width; cycle += counter)
+//This function blocks until a message with the given tag arrives from
+//the given source. Steal requests that show up in the meantime are
+//turned down, since there is nothing queued to give away.
+static void waitForReply(int source, int tag, int *run, MPI_Status *status)
+{
+    while (true)
     {
-        for (int column = cycle; (column - cycle < data->cycleSize) && (column < data->width); column++)
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, status);
+
+        if (status->MPI_TAG == TAG_STEAL_REQUEST)
         {
-            columns_per_process++;
+            int no_tiles = 0;
+            answerStealRequest(status->MPI_SOURCE, 0, &no_tiles);
+        }
+        else if (status->MPI_SOURCE == source && (tag == MPI_ANY_TAG || status->MPI_TAG == tag))
+        {
+            MPI_Recv(run, RUN_INFO_SIZE, MPI_INT, source, status->MPI_TAG, MPI_COMM_WORLD, status);
+            return;
         }
     }
-    int total_pixels = 3 *data->width *columns_per_process;
-    float *pixels = new float[total_pixels];
-    int next = 0;
-    start_column = data->mpi_rank * data->cycleSize;
-    
-    for (int cycle = start_column; cycle < data->width; cycle += counter)
+}
+
+void slaveGuided(ConfigData *data)
+{
+    MPI_Status status;
+
+    double computationTime = 0.0;
+    double communicationTime = 0.0;
+    int tilesRendered = 0;
+    int tilesStolen = 0;
+
+    //The master never hands out more than an equal share of the tiles,
+    //and steals only ever split a run, so this holds any run.
+    int slaves = data->mpi_procs - 1;
+    int total_tiles = tileCount(data);
+    int max_run = (total_tiles + slaves - 1) / slaves;
+    int tile_size = 3 * data->dynamicBlockWidth * data->dynamicBlockHeight;
+    float *pixels = new float[tile_size * max_run];
+
+    //The run that was just finished; empty on the first request.
+    int request[RUN_INFO_SIZE] = { 0, 0, -1 };
+
+    while (true)
     {
-        for (int column = cycle; (column - cycle < data->cycleSize) && (column < data->width); column++)
+        int run[RUN_INFO_SIZE];
+
+        double communicationStart = MPI_Wtime();
+        MPI_Send(request, RUN_INFO_SIZE, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+        if (request[1] > 0)
+        {
+            sendPixels(pixels, tile_size * request[1], 0, TAG_RESULT);
+        }
+
+        waitForReply(0, MPI_ANY_TAG, run, &status);
+
+        if (status.MPI_TAG == TAG_TERMINATE)
+        {
+            communicationTime += MPI_Wtime() - communicationStart;
+            break;
+        }
+
+        if (status.MPI_TAG == TAG_VICTIM)
         {
-            for (int row = 0; row < data->height; row++)
+            int victim = run[0];
+
+            MPI_Send(NULL, 0, MPI_INT, victim, TAG_STEAL_REQUEST, MPI_COMM_WORLD);
+            waitForReply(victim, TAG_STEAL_REPLY, run, &status);
+
+            if (run[1] == 0)
             {
+                //Tell the master so it stops pointing at this victim.
+                communicationTime += MPI_Wtime() - communicationStart;
+                request[0] = 0;
+                request[1] = 0;
+                request[2] = victim;
+                continue;
+            }
+
+            tilesStolen += run[1];
+        }
+        communicationTime += MPI_Wtime() - communicationStart;
 
-                int baseIndex = 3 * (row + next * data->width);
-                shadePixel(&(pixels[baseIndex]), row, column, data);
+        //Render the run one tile at a time, checking for thieves
+        //between tiles so that idle slaves are not kept waiting.
+        int first_tile = run[0];
+        int next_tile = first_tile;
+        int end_tile = first_tile + run[1];
+
+        while (next_tile < end_tile)
+        {
+            int tile[TILE_INFO_SIZE];
+            tileBounds(data, next_tile, tile);
+
+            float *tile_pixels = &(pixels[(next_tile - first_tile) * tile_size]);
+
+            double computationStart = MPI_Wtime();
+
+            renderTile(tile_pixels, tile, data);
+
+            computationTime += MPI_Wtime() - computationStart;
+            next_tile++;
+            tilesRendered++;
+
+            int pending = 0;
+            MPI_Iprobe(MPI_ANY_SOURCE, TAG_STEAL_REQUEST, MPI_COMM_WORLD, &pending, &status);
+            while (pending)
+            {
+                answerStealRequest(status.MPI_SOURCE, next_tile, &end_tile);
+                MPI_Iprobe(MPI_ANY_SOURCE, TAG_STEAL_REQUEST, MPI_COMM_WORLD, &pending, &status);
             }
-            next++;
         }
-    }
 
-    
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
+        request[0] = first_tile;
+        request[1] = end_tile - first_tile;
+        request[2] = -1;
+    }
 
-    MPI_Send(pixels,total_pixels, MPI_FLOAT, 0, 0, MPI_COMM_WORLD);
-    MPI_Send(&computationTime, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+    delete[] pixels;
 
-}
\ No newline at end of file
+    //{ computation time, communication time, tiles rendered, tiles stolen }
+    double stats[4] = { computationTime, communicationTime, (double)tilesRendered, (double)tilesStolen };
+    MPI_Send(stats, 4, MPI_DOUBLE, 0, TAG_DATA, MPI_COMM_WORLD);
+}
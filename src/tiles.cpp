@@ -0,0 +1,46 @@
+//This file contains the tile numbering shared by the master and the
+//slaves when dynamic partitioning is used.
+
+#include <algorithm>
+#include <vector>
+#include "tiles.h"
+#include "traversal.h"
+
+//The position of every tile number, or empty when they are numbered
+//row by row.
+static std::vector<int> tileOrder;
+
+int tileCount(ConfigData* data)
+{
+    int tiles_across = (data->width + data->dynamicBlockWidth - 1) / data->dynamicBlockWidth;
+    int tiles_down = (data->height + data->dynamicBlockHeight - 1) / data->dynamicBlockHeight;
+
+    return tiles_across * tiles_down;
+}
+
+void orderTiles(ConfigData* data, TraversalOrder order)
+{
+    tileOrder.clear();
+
+    if (order != ORDER_ROWS && data->dynamicBlockWidth > 0 && data->dynamicBlockHeight > 0)
+    {
+        int tiles_across = (data->width + data->dynamicBlockWidth - 1) / data->dynamicBlockWidth;
+        int tiles_down = (data->height + data->dynamicBlockHeight - 1) / data->dynamicBlockHeight;
+        curveOrder(tiles_across, tiles_down, order, tileOrder);
+    }
+}
+
+void tileBounds(ConfigData* data, int index, int* tile)
+{
+    int tiles_across = (data->width + data->dynamicBlockWidth - 1) / data->dynamicBlockWidth;
+
+    if (!tileOrder.empty())
+    {
+        index = tileOrder[index];
+    }
+
+    tile[0] = (index % tiles_across) * data->dynamicBlockWidth;
+    tile[1] = (index / tiles_across) * data->dynamicBlockHeight;
+    tile[2] = std::min(data->dynamicBlockWidth, data->width - tile[0]);
+    tile[3] = std::min(data->dynamicBlockHeight, data->height - tile[1]);
+}
@@ -0,0 +1,111 @@
+//This file contains the space-filling curves used to order the pixels
+//and tiles that are shaded.
+
+#include <algorithm>
+#include "traversal.h"
+
+static TraversalOrder currentOrder = ORDER_ROWS;
+
+void setTraversalOrder(TraversalOrder order)
+{
+    currentOrder = order;
+}
+
+TraversalOrder traversalOrder()
+{
+    return currentOrder;
+}
+
+//This function computes the point at a distance along a Morton curve,
+//which interleaves the bits of the column and the row.
+static void mortonPoint(int distance, int* x, int* y)
+{
+    *x = 0;
+    *y = 0;
+    for (int bit = 0; (distance >> (2 * bit)) != 0; bit++)
+    {
+        *x |= ((distance >> (2 * bit)) & 1) << bit;
+        *y |= ((distance >> (2 * bit + 1)) & 1) << bit;
+    }
+}
+
+//This function computes the point at a distance along a Hilbert curve
+//that fills a side x side square; side is a power of two.
+static void hilbertPoint(int side, int distance, int* x, int* y)
+{
+    *x = 0;
+    *y = 0;
+    for (int size = 1; size < side; size *= 2)
+    {
+        int right = 1 & (distance / 2);
+        int up = 1 & (distance ^ right);
+
+        //Rotate the quadrant so the curve enters and leaves it at the
+        //right corners.
+        if (up == 0)
+        {
+            if (right == 1)
+            {
+                *x = size - 1 - *x;
+                *y = size - 1 - *y;
+            }
+            std::swap(*x, *y);
+        }
+
+        *x += size * right;
+        *y += size * up;
+        distance /= 4;
+    }
+}
+
+void curveOrder(int columns, int rows, TraversalOrder order, std::vector<int>& cells)
+{
+    cells.clear();
+
+    if (order == ORDER_ROWS || columns <= 1 || rows <= 1)
+    {
+        for (int cell = 0; cell < columns * rows; cell++)
+        {
+            cells.push_back(cell);
+        }
+        return;
+    }
+
+    //The curves fill squares with a power of two side, so the grid is
+    //covered with squares that are as big as its shorter side, and the
+    //points that fall outside of it are skipped.
+    int side = 1;
+    while (side < std::min(columns, rows))
+    {
+        side *= 2;
+    }
+
+    bool wide = columns >= rows;
+    int squares = ((wide ? columns : rows) + side - 1) / side;
+
+    for (int square = 0; square < squares; square++)
+    {
+        int start_column = wide ? square * side : 0;
+        int start_row = wide ? 0 : square * side;
+
+        for (int distance = 0; distance < side * side; distance++)
+        {
+            int x, y;
+            if (order == ORDER_MORTON)
+            {
+                mortonPoint(distance, &x, &y);
+            }
+            else
+            {
+                hilbertPoint(side, distance, &x, &y);
+            }
+
+            x += start_column;
+            y += start_row;
+            if (x < columns && y < rows)
+            {
+                cells.push_back(y * columns + x);
+            }
+        }
+    }
+}
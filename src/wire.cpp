@@ -0,0 +1,244 @@
+//This file contains the conversion of pixels to and from the compact
+//formats that can be used to send them to the master.
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include "wire.h"
+
+static WireFormat format = WIRE_FLOAT;
+
+//The pixel bytes received from every rank.
+static std::vector<long long> receivedBytes;
+
+//This function converts a float to an IEEE 754 half float, rounding to
+//the nearest value. Values that are too large become infinity.
+static unsigned short floatToHalf(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    unsigned short sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = bits & 0x7fffff;
+
+    //Infinity and NaN, keeping NaNs NaN.
+    if (((bits >> 23) & 0xff) == 0xff)
+    {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+
+    //Too large for a half.
+    if (exponent >= 31)
+    {
+        return sign | 0x7c00;
+    }
+
+    //Too small even for a subnormal half.
+    if (exponent < -10)
+    {
+        return sign;
+    }
+
+    //Subnormal halves have an implicit exponent of -14.
+    if (exponent <= 0)
+    {
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int midpoint = 1u << (shift - 1);
+
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+        {
+            half++;
+        }
+        return sign | half;
+    }
+
+    //Round to nearest even; a carry out of the mantissa correctly bumps
+    //the exponent, up to infinity.
+    unsigned int half = ((unsigned int)exponent << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1fff;
+
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return sign | half;
+}
+
+//This function converts an IEEE 754 half float to a float.
+static float halfToFloat(unsigned short half)
+{
+    unsigned int sign = (unsigned int)(half & 0x8000) << 16;
+    unsigned int exponent = (half >> 10) & 0x1f;
+    unsigned int mantissa = half & 0x3ff;
+    unsigned int bits;
+
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        bits = sign;
+    }
+    else
+    {
+        //Normalize the subnormal half.
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void setWireFormat(WireFormat selected, int procs)
+{
+    format = selected;
+    receivedBytes.assign(procs, 0);
+}
+
+WireFormat wireFormat()
+{
+    return format;
+}
+
+int wireBytes(int values)
+{
+    switch (format)
+    {
+        case WIRE_HALF:
+            return values * (int)sizeof(unsigned short);
+        case WIRE_BYTE:
+            return values;
+        default:
+            return values * (int)sizeof(float);
+    }
+}
+
+unsigned char quantizeChannel(float value)
+{
+    return (value > 1.0f) ? 255 : (unsigned char)(int)(value * 255.0f);
+}
+
+void encodePixels(float* pixels, int values, unsigned char* buffer)
+{
+    switch (format)
+    {
+        case WIRE_HALF:
+        {
+            unsigned short* halves = (unsigned short*)buffer;
+            for (int i = 0; i < values; i++)
+            {
+                halves[i] = floatToHalf(pixels[i]);
+            }
+            break;
+        }
+        case WIRE_BYTE:
+            for (int i = 0; i < values; i++)
+            {
+                buffer[i] = quantizeChannel(pixels[i]);
+            }
+            break;
+        default:
+            memcpy(buffer, pixels, values * sizeof(float));
+            break;
+    }
+}
+
+void decodePixels(unsigned char* buffer, int values, float* pixels)
+{
+    switch (format)
+    {
+        case WIRE_HALF:
+        {
+            unsigned short* halves = (unsigned short*)buffer;
+            for (int i = 0; i < values; i++)
+            {
+                pixels[i] = halfToFloat(halves[i]);
+            }
+            break;
+        }
+        case WIRE_BYTE:
+            //Decode to the middle of the interval, so that quantizing the
+            //value again gives back the same byte.
+            for (int i = 0; i < values; i++)
+            {
+                pixels[i] = (buffer[i] + 0.5f) / 255.0f;
+            }
+            break;
+        default:
+            memcpy(pixels, buffer, values * sizeof(float));
+            break;
+    }
+}
+
+void sendPixels(float* pixels, int values, int dest, int tag)
+{
+    if (format == WIRE_FLOAT)
+    {
+        MPI_Send(pixels, values, MPI_FLOAT, dest, tag, MPI_COMM_WORLD);
+        return;
+    }
+
+    unsigned char* buffer = new unsigned char[wireBytes(values)];
+    encodePixels(pixels, values, buffer);
+    MPI_Send(buffer, wireBytes(values), MPI_BYTE, dest, tag, MPI_COMM_WORLD);
+    delete[] buffer;
+}
+
+void recvPixels(float* pixels, int values, int source, int tag, MPI_Status* status)
+{
+    if (format == WIRE_FLOAT)
+    {
+        MPI_Recv(pixels, values, MPI_FLOAT, source, tag, MPI_COMM_WORLD, status);
+    }
+    else
+    {
+        unsigned char* buffer = new unsigned char[wireBytes(values)];
+        MPI_Recv(buffer, wireBytes(values), MPI_BYTE, source, tag, MPI_COMM_WORLD, status);
+        decodePixels(buffer, values, pixels);
+        delete[] buffer;
+    }
+
+    countWireBytes(status->MPI_SOURCE, wireBytes(values));
+}
+
+void countWireBytes(int rank, long long bytes)
+{
+    receivedBytes[rank] += bytes;
+}
+
+void printWireBytes()
+{
+    long long total = 0;
+    for (size_t rank = 0; rank < receivedBytes.size(); rank++)
+    {
+        total += receivedBytes[rank];
+    }
+
+    if (total == 0)
+    {
+        return;
+    }
+
+    std::cout << "Pixel Bytes Received:" << std::endl;
+    for (size_t rank = 1; rank < receivedBytes.size(); rank++)
+    {
+        std::cout << "    Rank " << rank << ": " << receivedBytes[rank] << " bytes" << std::endl;
+    }
+    std::cout << "    Total: " << total << " bytes" << std::endl;
+}